@@ -50,7 +50,8 @@ main(int argc, char** argv)
 
   for (;;) {
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
+    // Sleep until there is an event or the ui needs a new frame
+    for (bool got = state.waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
       state.event(ev);
       if (ev.type == SDL_QUIT) {
         return 0;
@@ -166,13 +167,14 @@ main(int argc, char** argv)
     dui::textureBox(f, texture, {400, 300, 256, 256});
 
     // Render
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(renderer, nullptr);
+    f.end();
 
-    f.render();
+    // Only redraw when something changed, and then only the changed areas
+    if (state.isDirty()) {
+      state.renderDamaged({255, 255, 255, 255});
 
-    SDL_RenderPresent(renderer);
-    SDL_Delay(1);
+      SDL_RenderPresent(renderer);
+    }
   }
   return 1;
 }
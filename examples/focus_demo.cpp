@@ -40,7 +40,8 @@ main(int argc, char** argv)
     bool keyboardFocus = state.wantsKeyboard();
 
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
+    // Sleep until there is an event or the ui needs a new frame
+    for (bool got = state.waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
       state.event(ev);
       if (ev.type == SDL_QUIT) {
         return 0;
@@ -63,13 +64,15 @@ main(int argc, char** argv)
     }
 
     // Render
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(renderer, nullptr);
+    f.end();
+    if (state.isDirty()) {
+      SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+      SDL_RenderFillRect(renderer, nullptr);
 
-    f.render();
+      state.render();
 
-    SDL_RenderPresent(renderer);
-    SDL_Delay(1);
+      SDL_RenderPresent(renderer);
+    }
   }
   return 1;
 }
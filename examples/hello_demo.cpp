@@ -26,7 +26,8 @@ main(int argc, char** argv)
   for (;;) {
     // Event handling
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
+    // Sleep until there is an event or the ui needs a new frame
+    for (bool got = state.waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
       // Send event to the state
       state.event(ev);
 
@@ -48,16 +49,21 @@ main(int argc, char** argv)
       SDL_PushEvent(&ev);
     }
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(renderer, nullptr);
+    // End frame
+    f.end();
 
-    // End frame and render state
-    f.render();
+    // Only redraw when something changed
+    if (state.isDirty()) {
+      // Clear screen
+      SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+      SDL_RenderFillRect(renderer, nullptr);
 
-    // Present and wait a bit
-    SDL_RenderPresent(renderer);
-    SDL_Delay(1);
+      // Render state
+      state.render();
+
+      // Present
+      SDL_RenderPresent(renderer);
+    }
   }
   return 1;
 }
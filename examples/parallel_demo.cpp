@@ -0,0 +1,136 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "dui.hpp"
+
+// Each surface has its own state and variables
+struct Surface
+{
+  std::unique_ptr<dui::State> state;
+  SDL_Rect rect;
+  std::string text{"Ahoy"};
+  int value = 0;
+  int clicks = 0;
+};
+
+void
+buildSurface(Surface& surface, unsigned index)
+{
+  auto f = dui::frame(*surface.state);
+  if (auto p = dui::panel(f, {"surface", index}, surface.rect)) {
+    dui::textField(p, "text", &surface.text);
+    dui::numberField(p, "value", &surface.value);
+    dui::sliderBox(p, "slider", &surface.value, 0, 100);
+    if (dui::button(p, "Click me")) {
+      surface.clicks += 1;
+    }
+    dui::label(p, surface.clicks % 2 ? "Odd" : "Even");
+  }
+  f.end();
+}
+
+int
+main(int argc, char** argv)
+{
+  // With --headless it runs a scripted session without a window and exits,
+  // which is useful to check it with -DDUI_SANITIZE_THREAD=ON
+  bool headless = argc > 1 && SDL_strcmp(argv[1], "--headless") == 0;
+
+  // Init SDL
+  if (SDL_Init(headless ? 0 : SDL_INIT_VIDEO) < 0) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  // Create window and renderer
+  SDL_Window* window = nullptr;
+  SDL_Renderer* renderer = nullptr;
+  if (headless) {
+    SDL_Surface* screen =
+      SDL_CreateRGBSurfaceWithFormat(0, 800, 600, 32, SDL_PIXELFORMAT_ARGB8888);
+    renderer = screen ? SDL_CreateSoftwareRenderer(screen) : nullptr;
+    if (!renderer) {
+      fprintf(stderr, "%s\n", SDL_GetError());
+      return 1;
+    }
+  } else if (SDL_CreateWindowAndRenderer(
+               800, 600, SDL_WINDOW_SHOWN, &window, &renderer) < 0) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  // The states must be created on the renderer's thread
+  std::vector<Surface> surfaces(8);
+  for (unsigned i = 0; i < surfaces.size(); ++i) {
+    surfaces[i].state = std::make_unique<dui::State>(renderer);
+    surfaces[i].rect = {int(i % 4) * 200, int(i / 4) * 300, 190, 290};
+  }
+
+  // The threads building the surfaces
+  dui::ThreadPool pool;
+
+  // Main loop
+  for (int frame = 0; !headless || frame < 600; ++frame) {
+    // Event handling
+    SDL_Event ev;
+    if (headless) {
+      // Click on the text field of each surface in turn and type on it
+      auto& rect = surfaces[(frame / 4) % surfaces.size()].rect;
+      SDL_zero(ev);
+      ev.type = frame % 4 < 2 ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+      ev.button.button = SDL_BUTTON_LEFT;
+      ev.button.x = rect.x + 20;
+      ev.button.y = rect.y + 10;
+      if (frame % 4 == 3) {
+        ev.type = SDL_TEXTINPUT;
+        SDL_strlcpy(ev.text.text, "a", sizeof(ev.text.text));
+      }
+      for (auto& surface : surfaces) {
+        surface.state->event(ev);
+      }
+    }
+    // Sleep until there is an event or a surface needs a new frame
+    int timeout = -1;
+    for (auto& surface : surfaces) {
+      int t = surface.state->getWaitTimeout();
+      if (t >= 0 && (timeout < 0 || t < timeout)) {
+        timeout = t;
+      }
+    }
+    bool got = !headless && (timeout < 0 ? SDL_WaitEvent(&ev)
+                                         : SDL_WaitEventTimeout(&ev, timeout));
+    for (; got; got = SDL_PollEvent(&ev)) {
+      // Send event to all states, each one checks if it is for it
+      for (auto& surface : surfaces) {
+        surface.state->event(ev);
+      }
+      if (ev.type == SDL_QUIT) {
+        return 0;
+      }
+    }
+
+    // Build each surface on its own thread
+    pool.run(surfaces.size(), [&](size_t index, size_t) {
+      buildSurface(surfaces[index], unsigned(index));
+    });
+
+    // Render on this thread, as SDL renderers are not thread safe
+    bool dirty = false;
+    for (auto& surface : surfaces) {
+      dirty = dirty || surface.state->isDirty();
+    }
+    if (dirty) {
+      SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+      SDL_RenderFillRect(renderer, nullptr);
+      for (auto& surface : surfaces) {
+        surface.state->render();
+      }
+      SDL_RenderPresent(renderer);
+    }
+  }
+  for (auto& surface : surfaces) {
+    printf("%s %d\n", surface.text.c_str(), surface.value);
+  }
+  return 0;
+}
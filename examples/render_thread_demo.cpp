@@ -0,0 +1,80 @@
+#include <optional>
+#include <SDL.h>
+#include "dui.hpp"
+
+int
+main(int argc, char** argv)
+{
+  // Init SDL
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  // The window stays on this thread, that handles its events
+  SDL_Window* window = SDL_CreateWindow("Render thread demo",
+                                        SDL_WINDOWPOS_UNDEFINED,
+                                        SDL_WINDOWPOS_UNDEFINED,
+                                        800,
+                                        600,
+                                        SDL_WINDOW_SHOWN);
+  if (!window) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  // Everything using the renderer, including creating it and the ui state
+  // (that creates the font texture), goes on the render thread
+  dui::RenderThread renderThread;
+  SDL_Renderer* renderer = nullptr;
+  std::optional<dui::State> state;
+  renderThread.call([&] {
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (renderer) {
+      state.emplace(renderer);
+    }
+  });
+  if (!renderer) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  // variables
+  int counter = 0;
+  std::string text = "Type here";
+
+  // Main loop
+  for (bool running = true; running;) {
+    // Event handling
+    SDL_Event ev;
+    // Sleep until there is an event or the ui needs a new frame
+    for (bool got = state->waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
+      state->event(ev);
+      if (ev.type == SDL_QUIT) {
+        running = false;
+      }
+    }
+
+    // Build the frame while the previous one is rendered. It waits if the
+    // frame before the previous is still rendering
+    auto f = dui::frame(*state);
+    dui::label(f, "Rendering on its own thread", {300, 180});
+    if (dui::button(f, "Count", {300, 200})) {
+      counter += 1;
+    }
+    dui::numberField(f, "Counter", &counter, {300, 230});
+    dui::textField(f, "Text", &text, {300, 260});
+    f.end();
+
+    // Hand it to the render thread, that clears, renders and presents it
+    state->submit(renderThread, {255, 255, 255, 255});
+  }
+
+  // Destroy everything on the render thread, after it finished rendering
+  renderThread.call([&] {
+    state.reset();
+    SDL_DestroyRenderer(renderer);
+  });
+  SDL_DestroyWindow(window);
+  return 0;
+}
@@ -24,12 +24,14 @@ main(int argc, char** argv)
 
   // variables
   SDL_Point var1 = {0, 10};
+  bool items[5] = {};
 
   // Main loop
   for (;;) {
     // Event handling
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
+    // Sleep until there is an event or the ui needs a new frame
+    for (bool got = state.waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
       // Send event to the state
       state.event(ev);
 
@@ -49,23 +51,29 @@ main(int argc, char** argv)
     dui::sliderBox(g, "intScroll2", &var1.y, 0, 10);
     dui::sliderBoxV(g, "intScroll3", &var1.y, 0, 100);
     if (auto sg = dui::scrollablePanel(g, "scrollGroup", &var1)) {
-      for (int i = 0; i < 5; ++i) {
-        dui::label(sg, "Label");
+      for (unsigned i = 0; i < 5; ++i) {
+        // Each gets its own id without formatting a string
+        dui::toggleButton(sg, {"item", i}, "Item", &items[i]);
       }
     }
     dui::label(g, "End");
     g.end();
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(renderer, nullptr);
+    // End frame
+    f.end();
 
-    // End frame and render state
-    f.render();
+    // Only redraw when something changed
+    if (state.isDirty()) {
+      // Clear screen
+      SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+      SDL_RenderFillRect(renderer, nullptr);
 
-    // Present and wait a bit
-    SDL_RenderPresent(renderer);
-    SDL_Delay(1);
+      // Render state
+      state.render();
+
+      // Present
+      SDL_RenderPresent(renderer);
+    }
   }
   return 1;
 }
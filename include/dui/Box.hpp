@@ -5,6 +5,7 @@
 #include "BoxStyle.hpp"
 #include "EdgeSize.hpp"
 #include "Group.hpp"
+#include "TextureAtlas.hpp"
 #include "Theme.hpp"
 
 namespace dui {
@@ -51,6 +52,35 @@ textureBox(Target target, SDL_Texture* texture, SDL_Rect rect)
   state.display(Shape::Texture(rect, texture));
 }
 
+/**
+ * @brief adds a texturedBox element showing an image from a TextureAtlas
+ * @ingroup elements
+ *
+ * @param target the parent group or frame
+ * @param image the image, as returned by TextureAtlas.add()
+ * @param rect the box local position and size. If the size is zero, it uses
+ * the image's
+ */
+inline void
+textureBox(Target target, const AtlasImage& image, SDL_Rect rect)
+{
+  auto& state = target.getState();
+  SDL_assert(state.isInFrame());
+  SDL_assert(!target.isLocked());
+  if (rect.w == 0 && rect.h == 0) {
+    rect.w = image.rect.w;
+    rect.h = image.rect.h;
+  }
+  auto caret = target.getCaret();
+  target.advance({rect.x + rect.w, rect.y + rect.h});
+  rect.x += caret.x;
+  rect.y += caret.y;
+  SDL_Rect srcRect = image.rect;
+  if (auto texture = image.getTexture()) {
+    state.display(Shape::Texture(rect, texture, srcRect));
+  }
+}
+
 /**
  * @brief A stylizable box
  * @ingroup elements
@@ -71,7 +101,7 @@ box(Target target, const SDL_Rect& r, const BoxStyle& style = themeFor<Box>())
   auto nsz = style.border.top;
   auto wsz = style.border.left;
   auto ssz = style.border.bottom;
-  auto g = group(target, {}, {0}, Layout::NONE);
+  auto g = unclippedGroup(target, {}, {0}, Layout::NONE);
   colorBox(g, {r.x + 1, r.y, r.w - 2, nsz}, {n.r, n.g, n.b, n.a});
   colorBox(g, {r.x, r.y + 1, wsz, r.h - 2}, {w.r, w.g, w.b, w.a});
   colorBox(g, {r.x + 1, r.y + r.h - ssz, r.w - 2, ssz}, {s.r, s.g, s.b, s.a});
@@ -23,14 +23,14 @@ namespace dui {
  */
 inline bool
 buttonBase(Target target,
-           std::string_view id,
+           Id id,
            std::string_view str,
            bool pushed,
            const SDL_Point& p = {0},
            const ButtonStyle& style = themeFor<ButtonBase>())
 {
   if (str.empty()) {
-    str = id;
+    str = id.getName();
   }
   auto adv = elementSize(style.padding + style.border,
                          measure(str, style.font, style.scale));
@@ -65,7 +65,7 @@ buttonBase(Target target,
  */
 inline bool
 button(Target target,
-       std::string_view id,
+       Id id,
        std::string_view str,
        const SDL_Point& p = {0},
        const ButtonStyle& style = themeFor<Button>())
@@ -102,7 +102,7 @@ button(Target target,
  */
 inline bool
 toggleButton(Target target,
-             std::string_view id,
+             Id id,
              std::string_view str,
              bool* value,
              const SDL_Point& p = {0},
@@ -148,7 +148,7 @@ toggleButton(Target target,
 template<class T, class U>
 inline bool
 choiceButton(Target target,
-             std::string_view id,
+             Id id,
              std::string_view str,
              T* value,
              U option,
@@ -0,0 +1,114 @@
+#ifndef DUI_COVERAGE_GRID_HPP_
+#define DUI_COVERAGE_GRID_HPP_
+
+#include <algorithm>
+#include <vector>
+#include <SDL.h>
+
+namespace dui {
+
+/**
+ * @brief Tracks which parts of an area are already covered by opaque shapes
+ *
+ * The area is split in square cells, each a bit that is set once a covering
+ * rect contains it entirely. A rect is only reported as covered if all cells
+ * it touches are, so the answer errs on the side of not covered, and checking
+ * a row of cells tests 64 of them at a time.
+ *
+ * DisplayList uses it to skip the shapes hidden under opaque ones, walking
+ * them from the topmost down.
+ */
+class CoverageGrid
+{
+public:
+  static constexpr int CELL_SIZE = 8; ///< The cell side, in pixels
+
+private:
+  std::vector<Uint64> words; ///< A bit per cell, row by row
+  int rowWords = 0;
+  int columns = 0;
+  int rows = 0;
+  SDL_Point origin{0, 0};
+
+public:
+  /// Clear all cells and resize it to cover area
+  void reset(const SDL_Rect& area);
+
+  /// Set the cells entirely inside r as covered
+  void cover(const SDL_Rect& r);
+
+  /// If all cells touching r are covered. False if r is empty or outside
+  bool isCovered(const SDL_Rect& r) const;
+
+private:
+  /// The cell of coordinate a, relative to the origin
+  static int floorDiv(int a)
+  {
+    return a >= 0 ? a / CELL_SIZE : ~(~a / CELL_SIZE);
+  }
+  /// The first cell starting at or after a, relative to the origin
+  static int ceilDiv(int a) { return floorDiv(a + CELL_SIZE - 1); }
+
+  /// The bits of word from cell c0 to c1 (exclusive)
+  static Uint64 wordMask(int word, int c0, int c1)
+  {
+    int lo = std::max(c0 - word * 64, 0);
+    int hi = std::min(c1 - word * 64, 64);
+    Uint64 bits = hi - lo == 64 ? ~Uint64(0) : (Uint64(1) << (hi - lo)) - 1;
+    return bits << lo;
+  }
+};
+
+inline void
+CoverageGrid::reset(const SDL_Rect& area)
+{
+  origin = {area.x, area.y};
+  columns = std::max(ceilDiv(area.w), 0);
+  rows = std::max(ceilDiv(area.h), 0);
+  rowWords = (columns + 63) / 64;
+  words.assign(size_t(rowWords) * rows, 0);
+}
+
+inline void
+CoverageGrid::cover(const SDL_Rect& r)
+{
+  int c0 = std::max(ceilDiv(r.x - origin.x), 0);
+  int c1 = std::min(floorDiv(r.x + r.w - origin.x), columns);
+  int r0 = std::max(ceilDiv(r.y - origin.y), 0);
+  int r1 = std::min(floorDiv(r.y + r.h - origin.y), rows);
+  if (c0 >= c1 || r0 >= r1) {
+    return;
+  }
+  for (int row = r0; row < r1; ++row) {
+    auto rowBits = &words[size_t(row) * rowWords];
+    for (int word = c0 / 64; word <= (c1 - 1) / 64; ++word) {
+      rowBits[word] |= wordMask(word, c0, c1);
+    }
+  }
+}
+
+inline bool
+CoverageGrid::isCovered(const SDL_Rect& r) const
+{
+  int c0 = floorDiv(r.x - origin.x);
+  int c1 = ceilDiv(r.x + r.w - origin.x);
+  int r0 = floorDiv(r.y - origin.y);
+  int r1 = ceilDiv(r.y + r.h - origin.y);
+  if (r.w <= 0 || r.h <= 0 || c0 < 0 || r0 < 0 || c1 > columns || r1 > rows) {
+    return false;
+  }
+  for (int row = r0; row < r1; ++row) {
+    auto rowBits = &words[size_t(row) * rowWords];
+    for (int word = c0 / 64; word <= (c1 - 1) / 64; ++word) {
+      auto mask = wordMask(word, c0, c1);
+      if ((rowBits[word] & mask) != mask) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace dui
+
+#endif // DUI_COVERAGE_GRID_HPP_
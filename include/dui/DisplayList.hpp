@@ -1,9 +1,27 @@
 #ifndef DUI_DISPLAY_LIST_HPP
 #define DUI_DISPLAY_LIST_HPP
 
+#include <algorithm>
+#include <climits>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <SDL_rect.h>
 #include <SDL_render.h>
+#include <SDL_version.h>
+#include "CoverageGrid.hpp"
+#include "Font.hpp"
+
+#if !defined(DUI_NO_SIMD) &&                                                   \
+  (defined(__SSE2__) || defined(_M_X64) ||                                     \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define DUI_SIMD_SSE2
+#elif !defined(DUI_NO_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DUI_SIMD_NEON
+#endif
 
 namespace dui {
 
@@ -47,110 +65,1514 @@ struct Shape
  */
 class DisplayList
 {
-  enum CommandType
+  enum CommandType : Uint8
   {
     POP_CLIP,
     PUSH_CLIP,
     SHAPE,
+    SHAPE_WITH_SRC, ///< A shape with its srcRect stored on srcRects
+    GLYPH_RUN,      ///< A text, with its details stored on glyphRuns
+    NOP,            ///< A POP_CLIP whose PUSH_CLIP was found redundant
+    LAYER,          ///< Another list, with its details stored on layers
+  };
+
+  /// A rect with 16 bit coordinates, as stored on the list
+  struct PackedRect
+  {
+    Sint16 x, y;
+    Uint16 w, h;
+  };
+
+  /// A texture and color pair, interned on palette
+  struct Paint
+  {
+    SDL_Texture* texture;
+    SDL_Color color;
+  };
+
+  // The commands, as parallel arrays
+  std::pmr::vector<CommandType> types;
+  std::pmr::vector<PackedRect> rects; ///< Shape or clip rect of each command
+  std::pmr::vector<Uint32> paints;    ///< Index on palette of each command
+  std::pmr::vector<PackedRect> srcRects; ///< One per SHAPE_WITH_SRC, in order
+
+  struct GlyphRun
+  {
+    Uint32 offset; ///< Where its text starts on glyphs
+    Uint32 length;
+    int x, y;      ///< Origin, unclamped
+    Uint16 table;  ///< Index on glyphTables
+    Uint16 scale;
+  };
+  std::pmr::vector<GlyphRun> glyphRuns; ///< One per GLYPH_RUN, in order
+  std::pmr::vector<char> glyphs;        ///< The text of all runs
+
+  struct Layer
+  {
+    const DisplayList* content;
+    Uint64 key; ///< Identifies it between frames
+    /// Where LayerCache rendered it, or null if it must be expanded
+    mutable SDL_Texture* texture;
+  };
+  std::pmr::vector<Layer> layers; ///< One per LAYER, in order
+
+  /// The source rect of each character of a font
+  struct GlyphTable
+  {
+    Font font;
+    PackedRect rects[256];
+  };
+  /// Kept between frames, as there are only a few fonts
+  std::vector<GlyphTable> glyphTables;
+
+  std::pmr::vector<Paint> palette;
+  std::pmr::vector<Uint32> paintSlots; ///< Hash table of palette index + 1
+
+  /// Clip rect pending to be closed by a pushClip()
+  struct ClipScope
+  {
+    size_t index;    ///< Where its POP_CLIP is
+    size_t srcIndex; ///< Size of srcRects when it was opened
+    size_t runIndex; ///< Size of glyphRuns when it was opened
+    size_t layerIndex; ///< Size of layers when it was opened
+    SDL_Rect bounds; ///< Bounds of everything visible inside it
+  };
+  std::pmr::vector<ClipScope> scopes;
+  SDL_Rect bounds{0}; ///< Bounds of everything visible outside any scope
+
+  /// Shapes resolved by visit(), kept to avoid reallocating every frame
+  struct CullBuffer
+  {
+    std::vector<size_t> commands; ///< Index of each shape command
+    std::vector<int> extra; ///< Index on srcRects, glyphRuns or layers, or -1
+    std::vector<int> clipIndex;   ///< Index on clips, or -1 if unclipped
+    std::vector<SDL_Rect> clips; ///< Effective clip rects
+    std::vector<int> stack;      ///< Indices of the clips currently open
+
+    // Bounds of each shape and of its clip, as struct of arrays
+    std::vector<int> x0, y0, x1, y1;
+    std::vector<int> clipX0, clipY0, clipX1, clipY1;
+    std::vector<Uint8> visible;
+
+    std::vector<Uint32> order; ///< The visible shapes, in the order drawn
+
+    /// Shapes sharing a texture that can be drawn together, see orderShapes()
+    struct Batch
+    {
+      SDL_Texture* texture;
+      int x0, y0, x1, y1; ///< Bounds of its shapes
+      std::vector<Uint32> shapes;
+    };
+    std::vector<Batch> batches; ///< Kept to reuse their shape vectors
+
+    void clear()
+    {
+      commands.clear();
+      extra.clear();
+      clipIndex.clear();
+      clips.clear();
+      stack.clear();
+      for (auto v : {&x0, &y0, &x1, &y1, &clipX0, &clipY0, &clipX1, &clipY1}) {
+        v->clear();
+      }
+    }
+
+    void add(size_t command, int extraIndex, const SDL_Rect& r)
+    {
+      commands.push_back(command);
+      extra.push_back(extraIndex);
+      x0.push_back(r.x);
+      y0.push_back(r.y);
+      x1.push_back(r.x + r.w);
+      y1.push_back(r.y + r.h);
+      if (r.w <= 0 || r.h <= 0) {
+        // Empty shapes are never visible
+        clipIndex.push_back(-1);
+        addClipBounds(INT_MAX, INT_MAX, INT_MIN, INT_MIN);
+      } else if (stack.empty()) {
+        clipIndex.push_back(-1);
+        addClipBounds(INT_MIN, INT_MIN, INT_MAX, INT_MAX);
+      } else {
+        auto& clip = clips[stack.back()];
+        clipIndex.push_back(stack.back());
+        addClipBounds(clip.x, clip.y, clip.x + clip.w, clip.y + clip.h);
+      }
+    }
+
+    void addClipBounds(int left, int top, int right, int bottom)
+    {
+      clipX0.push_back(left);
+      clipY0.push_back(top);
+      clipX1.push_back(right);
+      clipY1.push_back(bottom);
+    }
+  };
+  mutable CullBuffer culling;
+  /// Most shapes each one is compared to when reordering, see orderShapes()
+  static constexpr size_t MAX_ORDER_CHECKS = 256;
+  mutable CoverageGrid coverage;
+  /// Per paint, 1 if opaque, 0 if not and -1 if not known yet
+  mutable std::vector<Sint8> opaquePaints;
+  mutable size_t culledCount = 0;
+
+  static constexpr Uint64 FINGERPRINT_SEED = 0xcbf29ce484222325;
+  Uint64 fingerprint = FINGERPRINT_SEED;
+
+  static constexpr Uint64 mix(Uint64 hash, Uint64 word)
+  {
+    hash = (hash ^ word) * 0x100000001b3;
+    return hash ^ (hash >> 32);
+  }
+  static constexpr Uint64 mix(Uint64 hash, const SDL_Rect& r)
+  {
+    hash = mix(hash, Uint64(Uint32(r.x)) << 32 | Uint32(r.y));
+    return mix(hash, Uint64(Uint32(r.w)) << 32 | Uint32(r.h));
+  }
+  static Uint64 mix(Uint64 hash, const Shape& shape)
+  {
+    hash = mix(hash, Uint64(uintptr_t(shape.texture)));
+    hash = mix(hash, shape.rect);
+    hash = mix(hash, shape.srcRect);
+    return mix(hash, toWord(shape.color));
+  }
+
+  static constexpr Uint32 toWord(SDL_Color c)
+  {
+    return Uint32(c.r) << 24 | Uint32(c.g) << 16 | Uint32(c.b) << 8 | c.a;
+  }
+
+  static PackedRect pack(const SDL_Rect& r);
+  static SDL_Rect unpack(const PackedRect& r) { return {r.x, r.y, r.w, r.h}; }
+
+  /// Index of the paint on palette, adding it if needed
+  Uint32 intern(SDL_Texture* texture, SDL_Color color);
+
+  void add(CommandType type, const SDL_Rect& rect, Uint32 paint = 0)
+  {
+    types.push_back(type);
+    rects.push_back(pack(rect));
+    paints.push_back(paint);
+  }
+
+  /// A shape as it ends up on the screen, used to find damaged areas
+  struct VisibleShape
+  {
+    Uint64 hash;   ///< Hash of the shape and its clip
+    SDL_Rect rect; ///< The visible part of the shape
   };
+  std::vector<VisibleShape> presentedShapes;
+  std::vector<VisibleShape> currentShapes;
+  std::vector<SDL_Rect> damage;
+  static constexpr size_t MAX_DAMAGE_RECTS = 8;
 
-  struct Command
+  /// Tracks the renderer state, so we only call SDL when it changes
+  class RenderState
   {
-    union
+    SDL_Renderer* renderer = nullptr;
+    SDL_Rect clip{0};
+    bool clipEnabled = false;
+    SDL_Color drawColor{0};
+    bool drawColorKnown = false;
+    SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+    bool blendModeKnown = false;
+
+    struct TextureMod
     {
-      Shape shape;
-      SDL_Rect rect;
+      SDL_Texture* texture;
+      SDL_Color color;
     };
-    CommandType type;
-
-    Command()
-      : type(POP_CLIP)
-    {}
-    Command(const Shape& shape)
-      : shape(shape)
-      , type(SHAPE)
-    {}
-    Command(const SDL_Rect& rect)
-      : rect(rect)
-      , type(PUSH_CLIP)
-    {}
-  };
-  std::vector<Command> items;
+    std::vector<TextureMod> textureMods;
+
+    // Fills waiting to be submitted together
+    std::vector<SDL_Rect> fills;
+    SDL_Color fillColor{0};
+
+  public:
+    /// Forget everything and start tracking renderer, with no clip
+    void reset(SDL_Renderer* renderer);
+
+    /// Submit any pending fill
+    void flush();
+
+    bool clipChanged(const SDL_Rect* rect) const
+    {
+      return rect ? !clipEnabled || !SDL_RectEquals(rect, &clip) : clipEnabled;
+    }
+
+    /// Set the clip rect, or disable clipping if rect is null
+    void setClip(const SDL_Rect* rect);
+
+    void setBlendMode(SDL_BlendMode mode);
+
+    void setTextureMod(SDL_Texture* texture, SDL_Color color);
+
+    /// Fill rect, batching consecutive fills of the same color
+    void fill(const SDL_Rect& rect, SDL_Color color);
+
+    /// Copy texture modulated by color, or all of it if srcRect is null
+    void copy(SDL_Texture* texture,
+              const SDL_Rect* srcRect,
+              const SDL_Rect& rect,
+              SDL_Color color);
+  };
+  mutable RenderState renderState;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  // Scratch buffers for the batched renderer, reused between frames
+  mutable std::vector<SDL_Vertex> vertices;
+  mutable std::vector<int> indices;
+  mutable bool geometryFailed = false;
+#endif
 
 public:
-  void clear() { items.clear(); }
+  /**
+   * @brief Ctor
+   *
+   * @param resource where the commands are allocated. See reset().
+   */
+  explicit DisplayList(
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : types(resource)
+    , rects(resource)
+    , paints(resource)
+    , srcRects(resource)
+    , glyphRuns(resource)
+    , glyphs(resource)
+    , layers(resource)
+    , palette(resource)
+    , paintSlots(resource)
+    , scopes(resource)
+  {}
 
-  size_t size() { return items.size(); }
+  void clear()
+  {
+    types.clear();
+    rects.clear();
+    paints.clear();
+    srcRects.clear();
+    glyphRuns.clear();
+    glyphs.clear();
+    layers.clear();
+    palette.clear();
+    std::fill(paintSlots.begin(), paintSlots.end(), 0);
+    scopes.clear();
+    bounds = {0};
+    fingerprint = FINGERPRINT_SEED;
+  }
+
+  /**
+   * @brief Clear, dropping the storage without returning it to the resource
+   *
+   * Use it after the memory resource released everything at once, like
+   * FrameArena.reset() does. As much room as before is reserved again, so
+   * building a similar list requires no further allocations.
+   */
+  void reset();
+
+  size_t size() { return types.size(); }
 
+  /**
+   * @brief A rolling hash of all commands added since the last clear()
+   *
+   * Two lists with the same commands, in the same order, have the same
+   * fingerprint, so it can be used to detect if anything changed between
+   * frames. Only the texture pointers are considered, not their contents.
+   */
+  Uint64 getFingerprint() const { return fingerprint; }
+
+  /**
+   * @brief Add a shape
+   *
+   * Coordinates are stored with 16 bits, so the edges of rects are clamped
+   * between -32768 and 32767.
+   */
   void insert(const Shape& item)
   {
     if (item.color.a > 0) {
-      items.push_back(item);
+      auto paint = intern(item.texture, item.color);
+      if (item.srcRect.w) {
+        add(SHAPE_WITH_SRC, item.rect, paint);
+        srcRects.push_back(pack(item.srcRect));
+      } else {
+        add(SHAPE, item.rect, paint);
+      }
+      fingerprint = mix(mix(fingerprint, SHAPE), item);
+      addBounds(item.rect);
     }
   }
 
-  void pushClip(const SDL_Rect& rect)
+  /**
+   * @brief Add a text, as a single command
+   *
+   * The text is copied and only expanded into one shape per character when
+   * rendering.
+   *
+   * @param str the text
+   * @param p the position of the first character
+   * @param font the font
+   * @param scale 0: 1x, 1: 2x, 2: 4x, 3: 8x, and so on
+   * @param color the color
+   */
+  void insertText(std::string_view str,
+                  const SDL_Point& p,
+                  const Font& font,
+                  int scale,
+                  SDL_Color color);
+
+  /**
+   * @brief Add another list as a single command
+   *
+   * It renders as if its commands were added here, unless a LayerCache
+   * prepared it, in which case it is drawn as a single texture.
+   *
+   * @param content a list with no clip scope open. It must stay valid and
+   * unchanged while this is used.
+   * @param key identifies the content between frames, for LayerCache
+   */
+  void insertLayer(const DisplayList& content, Uint64 key);
+
+  /**
+   * @brief Close the clip opened by the matching popClip()
+   *
+   * As the list is rendered backwards, this clips everything added since the
+   * matching popClip(). The clip is dropped if it would change nothing, i.e.
+   * everything inside it is already within rect, and the whole scope is
+   * dropped if nothing inside it would be visible.
+   *
+   * @param rect the clip rect
+   */
+  void pushClip(const SDL_Rect& rect);
+
+  /**
+   * @brief Add all commands of other, as if they were added here
+   *
+   * The result renders exactly as if the commands were added directly to this
+   * list. The fingerprint, however, mixes the other's fingerprint as a whole,
+   * so it is only equal to the one of lists built the same way.
+   *
+   * @param other a list with no clip scope open
+   */
+  void append(const DisplayList& other);
+
+  /// Open a clip scope, to be closed by pushClip()
+  void popClip()
   {
-    // TODO coalesce multiple clips
-    if (rect.w > 0 && rect.h > 0) {
-      items.push_back(rect);
+    scopes.push_back({types.size(),
+                      srcRects.size(),
+                      glyphRuns.size(),
+                      layers.size(),
+                      {0, 0, 0, 0}});
+    add(POP_CLIP, {0});
+    fingerprint = mix(fingerprint, POP_CLIP);
+  }
+
+  /**
+   * @brief Render the list
+   *
+   * If the SDL version supports it (both compiled and linked against 2.0.18 or
+   * newer), consecutive shapes sharing the same texture and clip rect are
+   * submitted with a single SDL_RenderGeometry() call. Otherwise it falls back
+   * to renderDirect().
+   *
+   * @param renderer
+   * @param clip if not null, only render what is inside this rect
+   * @param offset added to all coordinates, except clip's
+   */
+  void render(SDL_Renderer* renderer,
+              const SDL_Rect* clip = nullptr,
+              const SDL_Point& offset = {0, 0}) const;
+
+  /**
+   * @brief Render the list issuing one draw call per shape
+   *
+   * @param renderer
+   * @param clip if not null, only render what is inside this rect
+   * @param offset added to all coordinates, except clip's
+   */
+  void renderDirect(SDL_Renderer* renderer,
+                    const SDL_Rect* clip = nullptr,
+                    const SDL_Point& offset = {0, 0}) const;
+
+  /**
+   * @brief Render only what changed since the last call into a canvas
+   *
+   * The list is compared against the one given on the previous call to find
+   * the damaged areas, where shapes were added, removed, moved or recolored.
+   * Only these areas are cleared with background and rendered again into the
+   * canvas, that is then copied to the current render target.
+   *
+   * @param renderer
+   * @param canvas a render target texture, persistent between calls. Its
+   * blend mode should be SDL_BLENDMODE_NONE.
+   * @param background the color to clear the damaged areas
+   * @param full if true the whole canvas is considered damaged. Use it the
+   * first time and when the canvas contents were lost.
+   */
+  void renderDamaged(SDL_Renderer* renderer,
+                     SDL_Texture* canvas,
+                     SDL_Color background,
+                     bool full);
+
+  /**
+   * @brief Take what other rendered on renderDamaged()
+   *
+   * Use it when alternating between lists, so the next renderDamaged() here
+   * compares against what other rendered last.
+   */
+  void takePresented(DisplayList& other)
+  {
+    presentedShapes.swap(other.presentedShapes);
+  }
+
+  /// The areas damaged on the last renderDamaged() call
+  const std::vector<SDL_Rect>& getDamage() const { return damage; }
+
+  /// Number of layers, added by insertLayer() or append()
+  size_t getLayerCount() const { return layers.size(); }
+
+  /**
+   * @brief Number of shapes skipped on the last render for being entirely
+   * outside their clip rect or hidden under opaque shapes
+   */
+  size_t getCulledCount() const { return culledCount; }
+
+  /**
+   * @brief Call func(shape, clip) for each shape, in render order
+   *
+   * The clip is the effective clip rect (already intersected with the outer
+   * ones) or nullptr if the shape is not clipped.
+   *
+   * If outerClip is given, all shapes are clipped by it. The shapes entirely
+   * outside their clip or hidden under opaque solid boxes are skipped. Layers
+   * are expanded into their shapes.
+   *
+   * This is how render() sees the list, so it can be used to render it by
+   * other means, like SoftwareRenderer does. The only difference is that
+   * render() groups the shapes by texture, drawing them in another order where
+   * that gives the same image.
+   */
+  template<class FUNC>
+  void visit(FUNC func, const SDL_Rect* outerClip = nullptr) const
+  {
+    visitShapes(func, outerClip, {0, 0}, false, false);
+  }
+
+private:
+  /**
+   * @brief visit() with offset added to all coordinates, drawing the layers
+   * with a texture as a single shape if useTextures and grouping the shapes
+   * by texture if reorder
+   *
+   * The renderArea, if given, is what can be seen, so only there the shapes
+   * are checked for occlusion.
+   */
+  template<class FUNC>
+  void visitShapes(FUNC& func,
+                   const SDL_Rect* outerClip,
+                   const SDL_Point& offset,
+                   bool useTextures,
+                   bool reorder,
+                   const SDL_Rect* renderArea = nullptr) const;
+
+  void addBounds(const SDL_Rect& rect)
+  {
+    auto& target = scopes.empty() ? bounds : scopes.back().bounds;
+    SDL_UnionRect(&target, &rect, &target);
+  }
+
+  /// Index on glyphTables of the font, adding it if needed
+  Uint16 findGlyphTable(const Font& font);
+
+  /// Fill culling with the shapes in render order and their effective clips
+  void resolveClips(const SDL_Rect* outerClip, const SDL_Point& offset) const;
+
+  /// Set culling.visible for each shape intersecting its clip rect
+  void cullShapes() const;
+
+  /**
+   * @brief Unset culling.visible for the shapes hidden by opaque ones above
+   *
+   * @param area where the shapes can be seen, at most the bounds with the
+   * render offset
+   * @param useTextures if the textures can be queried for their opacity
+   */
+  void occludeShapes(const SDL_Rect& area, bool useTextures) const;
+
+  /// If the shape command is drawn with no transparency
+  bool isOpaque(size_t command, bool useTextures) const;
+
+  /**
+   * @brief Fill culling.order with the visible shapes
+   *
+   * If reorder, the shapes under the same clip rect are grouped in batches
+   * sharing a texture (or none, for solid boxes), so they can be drawn
+   * together. A shape only moves past the ones it doesn't overlap or that are
+   * solid boxes of the same color, so the image stays the same.
+   */
+  void orderShapes(bool reorder) const;
+
+  void computeDamage(const SDL_Rect& screen, bool full);
+
+  void addDamage(SDL_Rect rect);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  static bool hasGeometrySupport();
+
+  void renderGeometry(SDL_Renderer* renderer,
+                      const SDL_Rect* clip,
+                      const SDL_Point& offset) const;
+
+  void renderQuads(SDL_Renderer* renderer,
+                   SDL_Texture* texture,
+                   const SDL_Point& textureSz) const;
+#endif
+
+  friend class LayerCache;
+};
+
+inline void
+DisplayList::pushClip(const SDL_Rect& rect)
+{
+  SDL_assert(!scopes.empty());
+  auto scope = scopes.back();
+  scopes.pop_back();
+  SDL_Rect clip = rect;
+  if (clip.w <= 0 || clip.h <= 0) {
+    clip.w = clip.h = 1;
+  }
+  SDL_Rect visible;
+  if (!SDL_IntersectRect(&scope.bounds, &clip, &visible)) {
+    // Nothing inside would be visible, so we drop the whole scope. This also
+    // removes the redundant NOPs left by any scope inside it
+    types.resize(scope.index);
+    rects.resize(scope.index);
+    paints.resize(scope.index);
+    srcRects.resize(scope.srcIndex);
+    if (glyphRuns.size() > scope.runIndex) {
+      glyphs.resize(glyphRuns[scope.runIndex].offset);
+      glyphRuns.resize(scope.runIndex);
+    }
+    layers.resize(scope.layerIndex);
+    return;
+  }
+  if (SDL_RectEquals(&visible, &scope.bounds)) {
+    // Everything is already inside, so clipping would change nothing
+    types[scope.index] = NOP;
+  } else {
+    add(PUSH_CLIP, clip);
+    fingerprint = mix(mix(fingerprint, PUSH_CLIP), clip);
+  }
+  addBounds(visible);
+}
+
+inline void
+DisplayList::reset()
+{
+  // Swapping never touches the old storage, that might be gone already
+  auto renew = [](auto& v) {
+    std::remove_reference_t<decltype(v)> fresh{v.get_allocator()};
+    fresh.reserve(v.capacity());
+    v.swap(fresh);
+  };
+  renew(types);
+  renew(rects);
+  renew(paints);
+  renew(srcRects);
+  renew(glyphRuns);
+  renew(glyphs);
+  renew(layers);
+  renew(palette);
+  renew(scopes);
+  auto slots = paintSlots.size();
+  renew(paintSlots);
+  paintSlots.resize(slots, 0);
+  bounds = {0};
+  fingerprint = FINGERPRINT_SEED;
+}
+
+inline void
+DisplayList::insertText(std::string_view str,
+                        const SDL_Point& p,
+                        const Font& font,
+                        int scale,
+                        SDL_Color color)
+{
+  if (color.a == 0 || str.empty()) {
+    return;
+  }
+  auto table = findGlyphTable(font);
+  SDL_Rect rect{p.x,
+                p.y,
+                int(str.size()) * (font.charW << scale),
+                font.charH << scale};
+  auto paint = intern(font.texture, color);
+  add(GLYPH_RUN, rect, paint);
+  glyphRuns.push_back({Uint32(glyphs.size()),
+                       Uint32(str.size()),
+                       p.x,
+                       p.y,
+                       Uint16(table),
+                       Uint16(scale)});
+  glyphs.insert(glyphs.end(), str.begin(), str.end());
+
+  fingerprint = mix(fingerprint, GLYPH_RUN);
+  fingerprint = mix(fingerprint, rect);
+  fingerprint = mix(fingerprint, Uint64(uintptr_t(font.texture)));
+  fingerprint = mix(fingerprint, toWord(color));
+  fingerprint = mix(fingerprint, Uint64(table) << 32 | Uint32(scale));
+  for (size_t i = 0; i < str.size(); i += 8) {
+    Uint64 word = 0;
+    SDL_memcpy(&word, str.data() + i, std::min(size_t(8), str.size() - i));
+    fingerprint = mix(fingerprint, word);
+  }
+  addBounds(rect);
+}
+
+inline void
+DisplayList::insertLayer(const DisplayList& content, Uint64 key)
+{
+  SDL_assert(content.scopes.empty());
+  if (content.bounds.w <= 0 || content.bounds.h <= 0) {
+    return;
+  }
+  add(LAYER, content.bounds);
+  layers.push_back({&content, key, nullptr});
+  fingerprint = mix(fingerprint, LAYER);
+  fingerprint = mix(fingerprint, key);
+  fingerprint = mix(fingerprint, content.fingerprint);
+  addBounds(content.bounds);
+}
+
+inline Uint16
+DisplayList::findGlyphTable(const Font& font)
+{
+  size_t table = 0;
+  while (table < glyphTables.size()) {
+    auto& f = glyphTables[table].font;
+    if (f.texture == font.texture && f.charW == font.charW &&
+        f.charH == font.charH && f.cols == font.cols &&
+        f.origin.x == font.origin.x && f.origin.y == font.origin.y) {
+      return Uint16(table);
+    }
+    ++table;
+  }
+  auto& glyphTable = glyphTables.emplace_back();
+  glyphTable.font = font;
+  for (int ch = 0; ch < 256; ++ch) {
+    glyphTable.rects[ch] = pack(font.glyph(ch));
+  }
+  return Uint16(table);
+}
+
+inline void
+DisplayList::append(const DisplayList& other)
+{
+  SDL_assert(other.scopes.empty());
+  if (other.types.empty()) {
+    return;
+  }
+  // Interning in the order other did gives the same indices as adding the
+  // commands here would
+  std::pmr::vector<Uint32> paintMap{types.get_allocator()};
+  paintMap.reserve(other.palette.size());
+  for (auto& paint : other.palette) {
+    paintMap.push_back(intern(paint.texture, paint.color));
+  }
+  std::pmr::vector<Uint16> tableMap{types.get_allocator()};
+  tableMap.reserve(other.glyphTables.size());
+  for (auto& table : other.glyphTables) {
+    tableMap.push_back(findGlyphTable(table.font));
+  }
+
+  types.insert(types.end(), other.types.begin(), other.types.end());
+  rects.insert(rects.end(), other.rects.begin(), other.rects.end());
+  for (size_t i = 0; i < other.types.size(); ++i) {
+    auto type = other.types[i];
+    bool painted = type == SHAPE || type == SHAPE_WITH_SRC || type == GLYPH_RUN;
+    paints.push_back(painted ? paintMap[other.paints[i]] : 0);
+  }
+  srcRects.insert(srcRects.end(), other.srcRects.begin(), other.srcRects.end());
+  auto glyphOffset = Uint32(glyphs.size());
+  for (auto run : other.glyphRuns) {
+    run.offset += glyphOffset;
+    run.table = tableMap[run.table];
+    glyphRuns.push_back(run);
+  }
+  glyphs.insert(glyphs.end(), other.glyphs.begin(), other.glyphs.end());
+  for (auto& layer : other.layers) {
+    layers.push_back({layer.content, layer.key, nullptr});
+  }
+
+  fingerprint = mix(fingerprint, other.fingerprint);
+  if (other.bounds.w > 0 && other.bounds.h > 0) {
+    addBounds(other.bounds);
+  }
+}
+
+inline DisplayList::PackedRect
+DisplayList::pack(const SDL_Rect& r)
+{
+  // Clamping the edges keeps whatever is on the screen
+  auto clamp = [](Sint64 v) {
+    return Sint16(v < SHRT_MIN ? SHRT_MIN : v > SHRT_MAX ? SHRT_MAX : v);
+  };
+  Sint16 x0 = clamp(r.x), y0 = clamp(r.y);
+  Sint16 x1 = clamp(Sint64(r.x) + r.w), y1 = clamp(Sint64(r.y) + r.h);
+  return {x0, y0, Uint16(x1 > x0 ? x1 - x0 : 0), Uint16(y1 > y0 ? y1 - y0 : 0)};
+}
+
+inline Uint32
+DisplayList::intern(SDL_Texture* texture, SDL_Color color)
+{
+  if (paintSlots.size() < 2 * (palette.size() + 1)) {
+    // Keep the table at most half full
+    paintSlots.assign(std::max(size_t(64), paintSlots.size() * 2), 0);
+    size_t mask = paintSlots.size() - 1;
+    for (size_t i = 0; i < palette.size(); ++i) {
+      auto& paint = palette[i];
+      size_t slot = mix(uintptr_t(paint.texture), toWord(paint.color)) & mask;
+      while (paintSlots[slot] != 0) {
+        slot = (slot + 1) & mask;
+      }
+      paintSlots[slot] = Uint32(i + 1);
+    }
+  }
+  size_t mask = paintSlots.size() - 1;
+  size_t slot = mix(uintptr_t(texture), toWord(color)) & mask;
+  while (paintSlots[slot] != 0) {
+    auto index = paintSlots[slot] - 1;
+    auto& paint = palette[index];
+    if (paint.texture == texture && toWord(paint.color) == toWord(color)) {
+      return index;
+    }
+    slot = (slot + 1) & mask;
+  }
+  palette.push_back({texture, color});
+  paintSlots[slot] = Uint32(palette.size());
+  return Uint32(palette.size() - 1);
+}
+
+template<class FUNC>
+inline void
+DisplayList::visitShapes(FUNC& func,
+                         const SDL_Rect* outerClip,
+                         const SDL_Point& offset,
+                         bool useTextures,
+                         bool reorder,
+                         const SDL_Rect* renderArea) const
+{
+  resolveClips(outerClip, offset);
+  cullShapes();
+  // Far apart shapes would make a huge grid, most of it never seen
+  SDL_Rect area{bounds.x + offset.x, bounds.y + offset.y, bounds.w, bounds.h};
+  if (outerClip) {
+    SDL_IntersectRect(&area, outerClip, &area);
+  }
+  if (renderArea) {
+    SDL_IntersectRect(&area, renderArea, &area);
+  }
+  occludeShapes(area, useTextures);
+  culledCount = 0;
+  for (size_t i = 0; i < culling.commands.size(); ++i) {
+    if (!culling.visible[i]) {
+      auto command = culling.commands[i];
+      if (types[command] == GLYPH_RUN) {
+        culledCount += glyphRuns[culling.extra[i]].length;
+      } else {
+        ++culledCount;
+      }
+    }
+  }
+  orderShapes(reorder);
+  for (size_t i : culling.order) {
+    size_t command = culling.commands[i];
+    int extra = culling.extra[i];
+    int clipIndex = culling.clipIndex[i];
+    auto clip = clipIndex < 0 ? nullptr : &culling.clips[clipIndex];
+    if (types[command] == LAYER) {
+      auto& layer = layers[extra];
+      if (useTextures && layer.texture) {
+        SDL_Rect rect{culling.x0[i],
+                      culling.y0[i],
+                      culling.x1[i] - culling.x0[i],
+                      culling.y1[i] - culling.y0[i]};
+        func(Shape::Texture(rect, layer.texture), clip);
+      } else {
+        // Its culling buffer is its own, so this one stays valid
+        layer.content->visitShapes(
+          func, clip, offset, useTextures, reorder, renderArea);
+        culledCount += layer.content->culledCount;
+      }
+      continue;
+    }
+    auto& paint = palette[paints[command]];
+    if (types[command] != GLYPH_RUN) {
+      Shape shape{paint.texture,
+                  unpack(rects[command]),
+                  extra < 0 ? SDL_Rect{0} : unpack(srcRects[extra]),
+                  paint.color};
+      shape.rect.x += offset.x;
+      shape.rect.y += offset.y;
+      func(shape, clip);
+      continue;
+    }
+    // Expand only the glyphs that intersect the clip
+    auto& run = glyphRuns[extra];
+    auto& table = glyphTables[run.table];
+    int w = table.font.charW << run.scale;
+    int h = table.font.charH << run.scale;
+    int runX = run.x + offset.x;
+    size_t first = 0, last = run.length;
+    if (clip && clip->x > runX) {
+      first = std::min(size_t((clip->x - runX) / w), last);
+    }
+    if (clip && Sint64(clip->x) + clip->w < Sint64(runX) + w * Sint64(last)) {
+      last = size_t((Sint64(clip->x) + clip->w - runX + w - 1) / w);
+    }
+    culledCount += run.length - (last - first);
+    Shape shape{paint.texture, {0, run.y + offset.y, w, h}, {0}, paint.color};
+    for (size_t j = first; j < last; ++j) {
+      shape.rect.x = runX + int(j) * w;
+      shape.srcRect =
+        unpack(table.rects[Uint8(glyphs[run.offset + j])]);
+      func(shape, clip);
+    }
+  }
+}
+
+inline void
+DisplayList::resolveClips(const SDL_Rect* outerClip,
+                          const SDL_Point& offset) const
+{
+  culling.clear();
+  if (outerClip) {
+    culling.stack.push_back(0);
+    culling.clips.push_back(*outerClip);
+  }
+  size_t stackBase = culling.stack.size();
+  // The srcRects and glyphRuns are consumed backwards too
+  int srcIndex = int(srcRects.size());
+  int runIndex = int(glyphRuns.size());
+  int layerIndex = int(layers.size());
+  for (size_t i = types.size(); i-- > 0;) {
+    auto type = types[i];
+    if (type == NOP) {
+      continue;
+    }
+    if (type == POP_CLIP) {
+      SDL_assert(culling.stack.size() > stackBase);
+      culling.stack.pop_back();
+      continue;
+    }
+    SDL_Rect rect = unpack(rects[i]);
+    rect.x += offset.x;
+    rect.y += offset.y;
+    if (type == PUSH_CLIP) {
+      if (!culling.stack.empty()) {
+        auto& outer = culling.clips[culling.stack.back()];
+        SDL_IntersectRect(&rect, &outer, &rect);
+      }
+      culling.stack.push_back(int(culling.clips.size()));
+      culling.clips.push_back(rect);
+      continue;
+    }
+    int extra = type == SHAPE_WITH_SRC ? --srcIndex
+                : type == GLYPH_RUN    ? --runIndex
+                : type == LAYER        ? --layerIndex
+                                       : -1;
+    culling.add(i, extra, rect);
+  }
+  SDL_assert(srcIndex == 0 && runIndex == 0 && layerIndex == 0);
+  SDL_assert(culling.stack.size() == stackBase);
+}
+
+inline void
+DisplayList::cullShapes() const
+{
+  auto& c = culling;
+  size_t count = c.commands.size();
+  c.visible.resize(count);
+  size_t i = 0;
+#if defined(DUI_SIMD_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    auto load = [&](const std::vector<int>& v) {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i*>(&v[i]));
+    };
+    __m128i x0 = load(c.x0), y0 = load(c.y0);
+    __m128i x1 = load(c.x1), y1 = load(c.y1);
+    __m128i clipX0 = load(c.clipX0), clipY0 = load(c.clipY0);
+    __m128i clipX1 = load(c.clipX1), clipY1 = load(c.clipY1);
+    __m128i in = _mm_and_si128(_mm_cmplt_epi32(x0, clipX1),
+                               _mm_cmplt_epi32(clipX0, x1));
+    in = _mm_and_si128(in, _mm_cmplt_epi32(y0, clipY1));
+    in = _mm_and_si128(in, _mm_cmplt_epi32(clipY0, y1));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(in));
+    for (int j = 0; j < 4; ++j) {
+      c.visible[i + j] = (mask >> j) & 1;
+    }
+  }
+#elif defined(DUI_SIMD_NEON)
+  for (; i + 4 <= count; i += 4) {
+    int32x4_t x0 = vld1q_s32(&c.x0[i]), y0 = vld1q_s32(&c.y0[i]);
+    int32x4_t x1 = vld1q_s32(&c.x1[i]), y1 = vld1q_s32(&c.y1[i]);
+    int32x4_t clipX0 = vld1q_s32(&c.clipX0[i]);
+    int32x4_t clipY0 = vld1q_s32(&c.clipY0[i]);
+    int32x4_t clipX1 = vld1q_s32(&c.clipX1[i]);
+    int32x4_t clipY1 = vld1q_s32(&c.clipY1[i]);
+    uint32x4_t in = vandq_u32(vcltq_s32(x0, clipX1), vcltq_s32(clipX0, x1));
+    in = vandq_u32(in, vcltq_s32(y0, clipY1));
+    in = vandq_u32(in, vcltq_s32(clipY0, y1));
+    uint32_t lanes[4];
+    vst1q_u32(lanes, in);
+    for (int j = 0; j < 4; ++j) {
+      c.visible[i + j] = lanes[j] != 0;
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    c.visible[i] = c.x0[i] < c.clipX1[i] && c.clipX0[i] < c.x1[i] &&
+                   c.y0[i] < c.clipY1[i] && c.clipY0[i] < c.y1[i];
+  }
+}
+
+inline void
+DisplayList::occludeShapes(const SDL_Rect& area, bool useTextures) const
+{
+  auto& c = culling;
+  coverage.reset(area);
+  opaquePaints.assign(palette.size(), -1);
+  // From the topmost down, so the covering shapes come first
+  for (size_t i = c.commands.size(); i-- > 0;) {
+    if (!c.visible[i]) {
+      continue;
+    }
+    int x0 = std::max(c.x0[i], c.clipX0[i]);
+    int y0 = std::max(c.y0[i], c.clipY0[i]);
+    int x1 = std::min(c.x1[i], c.clipX1[i]);
+    int y1 = std::min(c.y1[i], c.clipY1[i]);
+    SDL_Rect r{x0, y0, x1 - x0, y1 - y0};
+    if (coverage.isCovered(r)) {
+      c.visible[i] = false;
+    } else if (isOpaque(c.commands[i], useTextures)) {
+      coverage.cover(r);
+    }
+  }
+}
+
+inline bool
+DisplayList::isOpaque(size_t command, bool useTextures) const
+{
+  if (types[command] != SHAPE && types[command] != SHAPE_WITH_SRC) {
+    return false;
+  }
+  auto index = paints[command];
+  if (opaquePaints[index] < 0) {
+    auto& paint = palette[index];
+    bool opaque = paint.texture == nullptr && paint.color.a == 255;
+    if (paint.texture != nullptr && useTextures) {
+      // Textures are only color modulated, so only their pixels count
+      Uint32 format;
+      SDL_BlendMode mode;
+      opaque = SDL_QueryTexture(
+                 paint.texture, &format, nullptr, nullptr, nullptr) == 0 &&
+               SDL_GetTextureBlendMode(paint.texture, &mode) == 0 &&
+               (mode == SDL_BLENDMODE_NONE ||
+                (mode == SDL_BLENDMODE_BLEND && paint.color.a == 255 &&
+                 !SDL_ISPIXELFORMAT_ALPHA(format)));
+    }
+    opaquePaints[index] = opaque;
+  }
+  return opaquePaints[index] > 0;
+}
+
+inline void
+DisplayList::orderShapes(bool reorder) const
+{
+  auto& c = culling;
+  size_t count = c.commands.size();
+  c.order.clear();
+  if (!reorder) {
+    for (size_t i = 0; i < count; ++i) {
+      if (c.visible[i]) {
+        c.order.push_back(Uint32(i));
+      }
+    }
+    return;
+  }
+  size_t batchCount = 0;
+  auto flush = [&] {
+    for (size_t b = 0; b < batchCount; ++b) {
+      auto& shapes = c.batches[b].shapes;
+      c.order.insert(c.order.end(), shapes.begin(), shapes.end());
+      shapes.clear();
+    }
+    batchCount = 0;
+  };
+  // As the shapes share the clip, their own rects overlapping is enough
+  auto overlaps = [&](size_t i, int x0, int y0, int x1, int y1) {
+    return c.x0[i] < x1 && x0 < c.x1[i] && c.y0[i] < y1 && y0 < c.y1[i];
+  };
+  auto commutes = [&](size_t i, size_t j) {
+    // Drawing the same solid box twice gives the same in any order
+    auto paint = paints[c.commands[i]];
+    return paint == paints[c.commands[j]] &&
+           palette[paint].texture == nullptr &&
+           types[c.commands[j]] != GLYPH_RUN;
+  };
+
+  size_t run = count; // The first shape under the current clip
+  for (size_t i = 0; i < count; ++i) {
+    if (!c.visible[i]) {
+      continue;
+    }
+    auto command = c.commands[i];
+    if (run == count || c.clipX0[i] != c.clipX0[run] ||
+        c.clipY0[i] != c.clipY0[run] || c.clipX1[i] != c.clipX1[run] ||
+        c.clipY1[i] != c.clipY1[run] || types[command] == LAYER) {
+      flush();
+      run = i;
+    }
+    if (types[command] == LAYER) {
+      // Drawn on its own, with its own batches if expanded
+      c.order.push_back(Uint32(i));
+      run = count;
+      continue;
+    }
+    int x0 = c.x0[i], y0 = c.y0[i], x1 = c.x1[i], y1 = c.y1[i];
+
+    // It must go on or above the last batch with a shape it overlaps. The
+    // first batch needs no check, and the latest shapes are the likeliest.
+    // Past MAX_ORDER_CHECKS it just assumes they overlap
+    size_t low = 0;
+    size_t checks = 0;
+    for (size_t b = batchCount; b-- > 1 && low == 0;) {
+      auto& batch = c.batches[b];
+      if (!(batch.x0 < x1 && x0 < batch.x1 && batch.y0 < y1 && y0 < batch.y1)) {
+        continue;
+      }
+      for (size_t k = batch.shapes.size(); k-- > 0;) {
+        auto j = batch.shapes[k];
+        if (++checks > MAX_ORDER_CHECKS ||
+            (overlaps(j, x0, y0, x1, y1) && !commutes(i, j))) {
+          low = b;
+          break;
+        }
+      }
+    }
+    auto texture = palette[paints[command]].texture;
+    size_t target = low;
+    while (target < batchCount && c.batches[target].texture != texture) {
+      ++target;
+    }
+    if (target == batchCount) {
+      if (c.batches.size() == batchCount) {
+        c.batches.emplace_back();
+      }
+      auto& batch = c.batches[batchCount++];
+      batch.texture = texture;
+      batch.x0 = x0;
+      batch.y0 = y0;
+      batch.x1 = x1;
+      batch.y1 = y1;
+    }
+    auto& batch = c.batches[target];
+    batch.x0 = std::min(batch.x0, x0);
+    batch.y0 = std::min(batch.y0, y0);
+    batch.x1 = std::max(batch.x1, x1);
+    batch.y1 = std::max(batch.y1, y1);
+    batch.shapes.push_back(Uint32(i));
+  }
+  flush();
+}
+
+inline void
+DisplayList::render(SDL_Renderer* renderer,
+                    const SDL_Rect* clip,
+                    const SDL_Point& offset) const
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (!geometryFailed && hasGeometrySupport()) {
+    renderGeometry(renderer, clip, offset);
+    return;
+  }
+#endif
+  renderDirect(renderer, clip, offset);
+}
+
+inline void
+DisplayList::renderDirect(SDL_Renderer* renderer,
+                          const SDL_Rect* clip,
+                          const SDL_Point& offset) const
+{
+  // Save render state
+  SDL_BlendMode blendMode;
+  SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+  // In the coordinates the shapes are drawn in
+  SDL_Rect viewport;
+  SDL_RenderGetViewport(renderer, &viewport);
+  viewport.x = viewport.y = 0;
+
+  auto& state = renderState;
+  state.reset(renderer);
+  state.setBlendMode(SDL_BLENDMODE_BLEND);
+  auto draw = [&](const Shape& shape, const SDL_Rect* shapeClip) {
+    state.setClip(shapeClip);
+    if (shape.texture == nullptr) {
+      state.fill(shape.rect, shape.color);
     } else {
-      items.push_back(SDL_Rect{rect.x, rect.y, 1, 1});
+      state.copy(shape.texture,
+                 shape.srcRect.w ? &shape.srcRect : nullptr,
+                 shape.rect,
+                 shape.color);
     }
+  };
+  visitShapes(draw, clip, offset, true, true, &viewport);
+  state.flush();
+  SDL_RenderSetClipRect(renderer, nullptr);
+  SDL_SetRenderDrawBlendMode(renderer, blendMode);
+}
+
+inline void
+DisplayList::renderDamaged(SDL_Renderer* renderer,
+                           SDL_Texture* canvas,
+                           SDL_Color background,
+                           bool full)
+{
+  SDL_Rect screen{0};
+  SDL_QueryTexture(canvas, nullptr, nullptr, &screen.w, &screen.h);
+  computeDamage(screen, full);
+
+  if (!damage.empty()) {
+    auto previousTarget = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, canvas);
+    SDL_BlendMode blendMode;
+    SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+    SDL_RenderSetClipRect(renderer, nullptr);
+    for (auto& rect : damage) {
+      SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+      SDL_SetRenderDrawColor(
+        renderer, background.r, background.g, background.b, background.a);
+      SDL_RenderFillRect(renderer, &rect);
+      render(renderer, &rect);
+    }
+    SDL_SetRenderDrawBlendMode(renderer, blendMode);
+    SDL_SetRenderTarget(renderer, previousTarget);
   }
+  SDL_RenderCopy(renderer, canvas, nullptr, nullptr);
+}
 
-  void popClip() { items.push_back({}); }
+inline void
+DisplayList::computeDamage(const SDL_Rect& screen, bool full)
+{
+  currentShapes.clear();
+  visit([&](const Shape& shape, const SDL_Rect* clip) {
+    SDL_Rect rect;
+    if (!SDL_IntersectRect(&shape.rect, clip ? clip : &screen, &rect) ||
+        !SDL_IntersectRect(&rect, &screen, &rect)) {
+      return;
+    }
+    auto hash = mix(FINGERPRINT_SEED, shape);
+    if (clip) {
+      hash = mix(hash, *clip);
+    }
+    currentShapes.push_back({hash, rect});
+  });
 
-  void render(SDL_Renderer* renderer) const;
-};
+  damage.clear();
+  if (full) {
+    damage.push_back(screen);
+  } else {
+    auto same = [](const VisibleShape& lhs, const VisibleShape& rhs) {
+      return lhs.hash == rhs.hash && SDL_RectEquals(&lhs.rect, &rhs.rect);
+    };
+    // Skip the common head and tail, what is left in between is changed
+    size_t curSz = currentShapes.size();
+    size_t prevSz = presentedShapes.size();
+    size_t head = 0;
+    while (head < curSz && head < prevSz &&
+           same(currentShapes[head], presentedShapes[head])) {
+      ++head;
+    }
+    size_t tail = 0;
+    while (tail < curSz - head && tail < prevSz - head &&
+           same(currentShapes[curSz - tail - 1],
+                presentedShapes[prevSz - tail - 1])) {
+      ++tail;
+    }
+    if (curSz == prevSz) {
+      // Likely moved or recolored, so we compare them one by one
+      for (size_t i = head; i < curSz - tail; ++i) {
+        if (!same(currentShapes[i], presentedShapes[i])) {
+          addDamage(currentShapes[i].rect);
+          addDamage(presentedShapes[i].rect);
+        }
+      }
+    } else {
+      for (size_t i = head; i < curSz - tail; ++i) {
+        addDamage(currentShapes[i].rect);
+      }
+      for (size_t i = head; i < prevSz - tail; ++i) {
+        addDamage(presentedShapes[i].rect);
+      }
+    }
+  }
+  std::swap(currentShapes, presentedShapes);
+}
 
 inline void
-DisplayList::render(SDL_Renderer* renderer) const
+DisplayList::addDamage(SDL_Rect rect)
+{
+  // Merge with any overlapping area, so we never render anything twice
+  for (size_t i = 0; i < damage.size();) {
+    if (SDL_HasIntersection(&damage[i], &rect)) {
+      SDL_UnionRect(&damage[i], &rect, &rect);
+      damage.erase(damage.begin() + i);
+      i = 0;
+    } else {
+      ++i;
+    }
+  }
+  damage.push_back(rect);
+  if (damage.size() > MAX_DAMAGE_RECTS) {
+    for (auto& r : damage) {
+      SDL_UnionRect(&r, &rect, &rect);
+    }
+    damage.clear();
+    damage.push_back(rect);
+  }
+}
+
+inline void
+DisplayList::RenderState::reset(SDL_Renderer* renderer)
+{
+  this->renderer = renderer;
+  drawColorKnown = false;
+  blendModeKnown = false;
+  textureMods.clear();
+  fills.clear();
+  clipEnabled = false;
+  SDL_RenderSetClipRect(renderer, nullptr);
+}
+
+inline void
+DisplayList::RenderState::flush()
+{
+  if (fills.empty()) {
+    return;
+  }
+  auto c = fillColor;
+  if (!drawColorKnown || c.r != drawColor.r || c.g != drawColor.g ||
+      c.b != drawColor.b || c.a != drawColor.a) {
+    SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+    drawColor = c;
+    drawColorKnown = true;
+  }
+  SDL_RenderFillRects(renderer, fills.data(), int(fills.size()));
+  fills.clear();
+}
+
+inline void
+DisplayList::RenderState::setClip(const SDL_Rect* rect)
+{
+  if (!clipChanged(rect)) {
+    return;
+  }
+  flush();
+  clipEnabled = rect != nullptr;
+  if (clipEnabled) {
+    clip = *rect;
+  }
+  SDL_RenderSetClipRect(renderer, rect);
+}
+
+inline void
+DisplayList::RenderState::setBlendMode(SDL_BlendMode mode)
+{
+  if (!blendModeKnown || mode != blendMode) {
+    flush();
+    SDL_SetRenderDrawBlendMode(renderer, mode);
+    blendMode = mode;
+    blendModeKnown = true;
+  }
+}
+
+inline void
+DisplayList::RenderState::setTextureMod(SDL_Texture* texture, SDL_Color color)
+{
+  // Few textures are used per frame, so a linear search is enough
+  for (auto& mod : textureMods) {
+    if (mod.texture == texture) {
+      if (mod.color.r != color.r || mod.color.g != color.g ||
+          mod.color.b != color.b) {
+        SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+        mod.color = color;
+      }
+      return;
+    }
+  }
+  SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+  textureMods.push_back({texture, color});
+}
+
+inline void
+DisplayList::RenderState::fill(const SDL_Rect& rect, SDL_Color color)
+{
+  if (!fills.empty() &&
+      (color.r != fillColor.r || color.g != fillColor.g ||
+       color.b != fillColor.b || color.a != fillColor.a)) {
+    flush();
+  }
+  fillColor = color;
+  fills.push_back(rect);
+}
+
+inline void
+DisplayList::RenderState::copy(SDL_Texture* texture,
+                               const SDL_Rect* srcRect,
+                               const SDL_Rect& rect,
+                               SDL_Color color)
+{
+  flush();
+  setTextureMod(texture, color);
+  SDL_RenderCopy(renderer, texture, srcRect, &rect);
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+inline bool
+DisplayList::hasGeometrySupport()
+{
+  // We might be linked against an older SDL than the one we were compiled with
+  static const bool supported = [] {
+    SDL_version version;
+    SDL_GetVersion(&version);
+    return SDL_VERSIONNUM(version.major, version.minor, version.patch) >=
+           SDL_VERSIONNUM(2, 0, 18);
+  }();
+  return supported;
+}
+
+inline void
+DisplayList::renderGeometry(SDL_Renderer* renderer,
+                            const SDL_Rect* clip,
+                            const SDL_Point& offset) const
 {
   // Save render state
   SDL_BlendMode blendMode;
   SDL_GetRenderDrawBlendMode(renderer, &blendMode);
-  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-
-  // Stack
-  constexpr int STACK_MAX_SIZE = 32;
-  SDL_Rect stack[STACK_MAX_SIZE]; // TODO make this configurable
-  int stackSz = 0;
-  for (auto it = items.rbegin(); it != items.rend(); it++) {
-    if (it->type == POP_CLIP) {
-      SDL_assert(stackSz > 0);
-      --stackSz;
-      SDL_RenderSetClipRect(renderer,
-                            stackSz > 0 ? &stack[stackSz - 1] : nullptr);
-      continue;
+  // In the coordinates the shapes are drawn in
+  SDL_Rect viewport;
+  SDL_RenderGetViewport(renderer, &viewport);
+  viewport.x = viewport.y = 0;
+
+  vertices.clear();
+  indices.clear();
+  SDL_Texture* texture = nullptr;
+  SDL_Point textureSz{1, 1};
+  auto& state = renderState;
+  state.reset(renderer);
+  state.setBlendMode(SDL_BLENDMODE_BLEND);
+
+  auto flush = [&] {
+    if (indices.empty()) {
+      return;
+    }
+    if (texture != nullptr) {
+      // The vertex colors already carry the modulation
+      state.setTextureMod(texture, {255, 255, 255, 255});
     }
-    if (it->type == PUSH_CLIP) {
-      SDL_assert(stackSz < STACK_MAX_SIZE);
-      SDL_Rect rect = it->rect;
-      if (stackSz > 0) {
-        SDL_IntersectRect(&it->rect, &stack[stackSz - 1], &rect);
+    if (geometryFailed || SDL_RenderGeometry(renderer,
+                                             texture,
+                                             vertices.data(),
+                                             int(vertices.size()),
+                                             indices.data(),
+                                             int(indices.size())) < 0) {
+      // Not supported by this renderer, so we never try again
+      geometryFailed = true;
+      renderQuads(renderer, texture, textureSz);
+    }
+    vertices.clear();
+    indices.clear();
+  };
+
+  auto draw = [&](const Shape& shape, const SDL_Rect* shapeClip) {
+    if (state.clipChanged(shapeClip)) {
+      flush();
+      state.setClip(shapeClip);
+    }
+    if (shape.texture != texture) {
+      flush();
+      texture = shape.texture;
+      if (texture == nullptr ||
+          SDL_QueryTexture(
+            texture, nullptr, nullptr, &textureSz.x, &textureSz.y) < 0) {
+        textureSz = {1, 1};
       }
-      stack[stackSz++] = rect;
-      SDL_RenderSetClipRect(renderer, &rect);
-      continue;
     }
-    auto& shape = it->shape;
+
+    // Textures are only color modulated, matching renderDirect()
     auto c = shape.color;
-    if (shape.texture == nullptr) {
-      SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-      SDL_RenderFillRect(renderer, &shape.rect);
+    if (texture != nullptr) {
+      c.a = 255;
     }
-    SDL_SetTextureColorMod(shape.texture, c.r, c.g, c.b);
+    float x0 = float(shape.rect.x);
+    float y0 = float(shape.rect.y);
+    float x1 = float(shape.rect.x + shape.rect.w);
+    float y1 = float(shape.rect.y + shape.rect.h);
+    float u0 = 0.f, v0 = 0.f, u1 = 1.f, v1 = 1.f;
     if (shape.srcRect.w) {
-      SDL_RenderCopy(renderer, shape.texture, &shape.srcRect, &shape.rect);
-    } else {
-      SDL_RenderCopy(renderer, shape.texture, nullptr, &shape.rect);
+      u0 = float(shape.srcRect.x) / textureSz.x;
+      v0 = float(shape.srcRect.y) / textureSz.y;
+      u1 = float(shape.srcRect.x + shape.srcRect.w) / textureSz.x;
+      v1 = float(shape.srcRect.y + shape.srcRect.h) / textureSz.y;
     }
-  }
+    int base = int(vertices.size());
+    vertices.push_back({{x0, y0}, c, {u0, v0}});
+    vertices.push_back({{x1, y0}, c, {u1, v0}});
+    vertices.push_back({{x1, y1}, c, {u1, v1}});
+    vertices.push_back({{x0, y1}, c, {u0, v1}});
+    for (int i : {0, 1, 2, 0, 2, 3}) {
+      indices.push_back(base + i);
+    }
+  };
+  visitShapes(draw, clip, offset, true, true, &viewport);
+  flush();
+  state.flush();
+
+  SDL_RenderSetClipRect(renderer, nullptr);
   SDL_SetRenderDrawBlendMode(renderer, blendMode);
-  SDL_assert(stackSz == 0);
 }
 
+inline void
+DisplayList::renderQuads(SDL_Renderer* renderer,
+                         SDL_Texture* texture,
+                         const SDL_Point& textureSz) const
+{
+  // Each quad is 4 vertices, from top left in clockwise order
+  for (size_t i = 0; i + 3 < vertices.size(); i += 4) {
+    auto& topLeft = vertices[i].position;
+    auto& bottomRight = vertices[i + 2].position;
+    SDL_Rect rect{int(topLeft.x),
+                  int(topLeft.y),
+                  int(bottomRight.x - topLeft.x),
+                  int(bottomRight.y - topLeft.y)};
+    auto c = vertices[i].color;
+    if (texture == nullptr) {
+      renderState.fill(rect, c);
+      continue;
+    }
+    auto& uvTopLeft = vertices[i].tex_coord;
+    auto& uvBottomRight = vertices[i + 2].tex_coord;
+    SDL_Rect srcRect{int(SDL_lroundf(uvTopLeft.x * textureSz.x)),
+                     int(SDL_lroundf(uvTopLeft.y * textureSz.y)),
+                     int(SDL_lroundf((uvBottomRight.x - uvTopLeft.x) *
+                                     textureSz.x)),
+                     int(SDL_lroundf((uvBottomRight.y - uvTopLeft.y) *
+                                     textureSz.y))};
+    renderState.copy(texture, &srcRect, rect, c);
+  }
+}
+#endif
+
 } // namespace dui
 
 #endif // DUI_DISPLAY_LIST_HPP
@@ -0,0 +1,234 @@
+#ifndef DUI_ELEMENT_CACHE_HPP_
+#define DUI_ELEMENT_CACHE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <SDL.h>
+#include "Id.hpp"
+
+namespace dui {
+
+/**
+ * @brief Typed data kept for elements between frames
+ *
+ * Each element id can have one value of each type, created the first time it
+ * is asked for and kept while it is asked for again. Values not asked for in
+ * getMaxAge() frames are destroyed all at once, so the elements that stop
+ * appearing don't leave anything behind.
+ *
+ * Lookups are on an open addressing table, so after an element first appears
+ * getting its data does no allocations.
+ */
+class ElementCache
+{
+  struct Entry
+  {
+    Uint64 key = 0; ///< 0 if empty
+    Uint32 lastUsed = 0;
+    const void* type = nullptr;
+    void* value = nullptr;
+    void (*destroy)(void*) = nullptr;
+  };
+  std::vector<Entry> entries; ///< Size is 0 or a power of 2
+  std::vector<Entry> spare;   ///< Reused when rehashing
+  size_t count = 0;
+  Uint32 generation = 0;
+  Uint32 lastCollect = 0;
+  Uint32 maxAge = 60;
+  std::vector<Uint64> tracked; ///< Keys used while tracking
+  unsigned tracking = 0;
+
+  /// Its address identifies T
+  template<class T>
+  static inline const char typeTag = 0;
+
+public:
+  /// Ctor
+  ElementCache() = default;
+
+  ElementCache(const ElementCache&) = delete;
+  ElementCache& operator=(const ElementCache&) = delete;
+
+  ~ElementCache() { clear(); }
+
+  /**
+   * @brief Get the value of type T for the element
+   *
+   * If there is none, a value initialized one is created.
+   *
+   * @param id the element id, as combined with its group (State.getCached()
+   * does that for you)
+   */
+  template<class T>
+  T& get(Uint64 id);
+
+  /**
+   * @brief Start keeping the keys of the values used
+   *
+   * It nests, each call returning where its keys begin. Together with touch()
+   * it keeps the values of elements that are replayed instead of built.
+   *
+   * @return the position to give to endTracking()
+   */
+  size_t beginTracking()
+  {
+    ++tracking;
+    return tracked.size();
+  }
+
+  /// Stop the tracking that began at first, giving the keys used since
+  void endTracking(size_t first, std::vector<Uint64>* keys);
+
+  /// Mark the values with the given keys as used, like get() does
+  void touch(const std::vector<Uint64>& keys);
+
+  /**
+   * @brief Advance to the next frame
+   *
+   * Every getMaxAge() frames this destroys the values not used since the last
+   * time.
+   */
+  void nextFrame();
+
+  /// Destroy the values not used in the last getMaxAge() frames
+  void collect();
+
+  /// Destroy all values
+  void clear();
+
+  /// Number of values
+  size_t size() const { return count; }
+
+  /// Frames a value is kept without being used
+  Uint32 getMaxAge() const { return maxAge; }
+
+  /// Set the frames a value is kept without being used
+  void setMaxAge(Uint32 value) { maxAge = value; }
+
+private:
+  /// The entry with key or the empty one where it would be
+  Entry& find(Uint64 key);
+
+  /// Move the entries to a new table, dropping the old ones if dropOld
+  void rehash(size_t capacity, bool dropOld);
+};
+
+template<class T>
+inline T&
+ElementCache::get(Uint64 id)
+{
+  auto type = &typeTag<T>;
+  Uint64 key = combineId(id, reinterpret_cast<uintptr_t>(type));
+  if ((count + 1) * 2 > entries.size()) {
+    rehash(entries.empty() ? 64 : entries.size() * 2, false);
+  }
+  auto& entry = find(key);
+  if (entry.key == 0) {
+    entry.key = key;
+    entry.type = type;
+    entry.value = new T{};
+    entry.destroy = [](void* value) { delete static_cast<T*>(value); };
+    ++count;
+  }
+  SDL_assert(entry.type == type);
+  entry.lastUsed = generation;
+  if (tracking > 0) {
+    tracked.push_back(key);
+  }
+  return *static_cast<T*>(entry.value);
+}
+
+inline void
+ElementCache::endTracking(size_t first, std::vector<Uint64>* keys)
+{
+  SDL_assert(tracking > 0 && first <= tracked.size());
+  keys->assign(tracked.begin() + first, tracked.end());
+  std::sort(keys->begin(), keys->end());
+  keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+  if (--tracking == 0) {
+    tracked.clear();
+  }
+}
+
+inline void
+ElementCache::touch(const std::vector<Uint64>& keys)
+{
+  if (entries.empty()) {
+    return;
+  }
+  for (auto key : keys) {
+    auto& entry = find(key);
+    if (entry.key != 0) {
+      entry.lastUsed = generation;
+      if (tracking > 0) {
+        tracked.push_back(key);
+      }
+    }
+  }
+}
+
+inline void
+ElementCache::nextFrame()
+{
+  ++generation;
+  if (generation - lastCollect >= maxAge) {
+    collect();
+  }
+}
+
+inline void
+ElementCache::collect()
+{
+  lastCollect = generation;
+  if (count > 0) {
+    rehash(entries.size(), true);
+  }
+}
+
+inline void
+ElementCache::clear()
+{
+  for (auto& entry : entries) {
+    if (entry.key != 0) {
+      entry.destroy(entry.value);
+      entry = {};
+    }
+  }
+  count = 0;
+}
+
+inline ElementCache::Entry&
+ElementCache::find(Uint64 key)
+{
+  size_t mask = entries.size() - 1;
+  for (size_t i = key & mask;; i = (i + 1) & mask) {
+    auto& entry = entries[i];
+    if (entry.key == key || entry.key == 0) {
+      return entry;
+    }
+  }
+}
+
+inline void
+ElementCache::rehash(size_t capacity, bool dropOld)
+{
+  spare.assign(capacity, Entry{});
+  spare.swap(entries);
+  count = 0;
+  for (auto& entry : spare) {
+    if (entry.key == 0) {
+      continue;
+    }
+    if (dropOld && generation - entry.lastUsed > maxAge) {
+      entry.destroy(entry.value);
+      continue;
+    }
+    find(entry.key) = entry;
+    ++count;
+  }
+}
+
+} // namespace dui
+
+#endif // DUI_ELEMENT_CACHE_HPP_
@@ -2,6 +2,7 @@
 #define DUI_FONT_HPP
 
 #include <SDL.h>
+#include "TextureAtlas.hpp"
 
 namespace dui {
 
@@ -10,21 +11,61 @@ struct Font
   SDL_Texture* texture;
   int charW, charH;
   int cols;
+  SDL_Point origin{0, 0}; ///< Where the glyphs start on texture
+
+  /// The source rect of ch on texture
+  SDL_Rect glyph(int ch) const
+  {
+    return {origin.x + (ch % cols) * charW,
+            origin.y + (ch / cols) * charH,
+            charW,
+            charH};
+  }
 };
 
 #include "defaultFont.h"
 
-inline Font
-loadDefaultFont(SDL_Renderer* renderer)
+/**
+ * @brief Load the pixels of the default font
+ *
+ * Useful to register them on a SoftwareRenderer. The caller must free it.
+ */
+inline SDL_Surface*
+loadDefaultFontSurface()
 {
   SDL_RWops* src = SDL_RWFromConstMem(font_bmp, font_bmp_len);
   SDL_Surface* surface = SDL_LoadBMP_RW(src, 1);
   SDL_SetColorKey(surface, 1, 0);
+  return surface;
+}
+
+inline Font
+loadDefaultFont(SDL_Renderer* renderer)
+{
+  SDL_Surface* surface = loadDefaultFontSurface();
   SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
   SDL_FreeSurface(surface);
   return {texture, 8, 8, 16};
 }
 
+/**
+ * @brief Load the default font into atlas
+ *
+ * So text shares its texture with the images on the atlas. If it can't be
+ * added, it falls back to a texture of its own.
+ */
+inline Font
+loadDefaultFont(TextureAtlas& atlas, SDL_Renderer* renderer)
+{
+  SDL_Surface* surface = loadDefaultFontSurface();
+  auto image = atlas.add(surface);
+  SDL_FreeSurface(surface);
+  if (!image) {
+    return loadDefaultFont(renderer);
+  }
+  return {image.getTexture(), 8, 8, 16, {image.rect.x, image.rect.y}};
+}
+
 } // namespace dui
 
 #endif
@@ -33,16 +33,27 @@ public:
   Frame& operator=(Frame&& rhs) = default;
 
   /**
-   * @brief Ends and then renders the frame
+   * @brief Ends and then renders the frame, if it changed
    *
-   * This is equivalent to call end(), followed by State.render().
+   * This is equivalent to call end(), followed by State.render() if
+   * State.isDirty().
+   *
+   * @return true if it was rendered
+   * @return false if it is identical to the last rendered frame, so nothing was
+   * done and you can skip SDL_RenderPresent(). If you clear the screen before
+   * rendering, consider checking State.isDirty() yourself, so you can skip the
+   * clearing too.
    */
-  void render()
+  bool render()
   {
     SDL_assert(state != nullptr);
     auto& state = *this->state;
     end();
+    if (!state.isDirty()) {
+      return false;
+    }
     state.render();
+    return true;
   }
 
   /// Finishes the frame and unlock the state
@@ -0,0 +1,158 @@
+#ifndef DUI_FRAME_ARENA_HPP_
+#define DUI_FRAME_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace dui {
+
+/**
+ * @brief A memory resource for things living only until the next frame
+ *
+ * Allocation just bumps a pointer on a single buffer and deallocation does
+ * nothing, as everything is released at once by reset(). If a frame needs
+ * more than the buffer has, the excess comes from the upstream resource and
+ * the buffer grows to fit it on the next reset(), so after a few frames
+ * nothing else is requested from upstream.
+ *
+ * Objects that need their destructor run can register it with
+ * destroyOnReset(), as arenaNew() does.
+ */
+class FrameArena : public std::pmr::memory_resource
+{
+  std::unique_ptr<std::byte[]> buffer;
+  size_t capacity = 0;
+  size_t used = 0;
+  size_t overflowed = 0; ///< Bytes requested beyond capacity
+  std::pmr::monotonic_buffer_resource overflow;
+
+  /// A destructor to run on reset(), kept on the arena itself
+  struct Destructor
+  {
+    void (*destroy)(void*);
+    void* object;
+    Destructor* next;
+  };
+  Destructor* destructors = nullptr; ///< The newest first
+
+  static constexpr size_t MIN_CAPACITY = 4096;
+
+public:
+  /// Ctor
+  FrameArena(std::pmr::memory_resource* upstream =
+               std::pmr::get_default_resource())
+    : overflow(upstream)
+  {}
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  ~FrameArena() { runDestructors(); }
+
+  /**
+   * @brief Release everything allocated so far
+   *
+   * The registered destructors run first, newest first. If the last frame did
+   * not fit, the buffer is reallocated with enough room for it.
+   */
+  void reset();
+
+  /// Call destroy(object) on the next reset() or when the arena is destroyed
+  void destroyOnReset(void (*destroy)(void*), void* object);
+
+  /// Bytes allocated since the last reset()
+  size_t getUsed() const { return used + overflowed; }
+
+  /// The buffer size
+  size_t getCapacity() const { return capacity; }
+
+protected:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+
+  void do_deallocate(void*, size_t, size_t) override {}
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+    noexcept override
+  {
+    return this == &other;
+  }
+
+private:
+  /// Run the registered destructors and forget them
+  void runDestructors();
+};
+
+inline void
+FrameArena::reset()
+{
+  runDestructors();
+  size_t needed = used + overflowed;
+  if (needed > capacity) {
+    overflow.release();
+    capacity = MIN_CAPACITY;
+    while (capacity < needed) {
+      capacity *= 2;
+    }
+    buffer.reset(new std::byte[capacity]);
+  }
+  used = 0;
+  overflowed = 0;
+}
+
+inline void*
+FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+  auto base = reinterpret_cast<uintptr_t>(buffer.get());
+  auto offset = ((base + used + alignment - 1) & ~(alignment - 1)) - base;
+  if (buffer && offset + bytes <= capacity) {
+    used = offset + bytes;
+    return buffer.get() + offset;
+  }
+  overflowed += bytes + alignment;
+  return overflow.allocate(bytes, alignment);
+}
+
+inline void
+FrameArena::destroyOnReset(void (*destroy)(void*), void* object)
+{
+  auto node = static_cast<Destructor*>(
+    allocate(sizeof(Destructor), alignof(Destructor)));
+  *node = {destroy, object, destructors};
+  destructors = node;
+}
+
+inline void
+FrameArena::runDestructors()
+{
+  // The nodes are on the arena, so they are still valid until it is released
+  for (auto node = destructors; node != nullptr; node = node->next) {
+    node->destroy(node->object);
+  }
+  destructors = nullptr;
+}
+
+/**
+ * @brief Move value into memory from arena
+ *
+ * It lives until the arena is reset, when it is destroyed if it has a non
+ * trivial destructor.
+ */
+template<class T>
+inline T*
+arenaNew(FrameArena& arena, T value)
+{
+  std::pmr::polymorphic_allocator<T> allocator{&arena};
+  auto object = new (allocator.allocate(1)) T(std::move(value));
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    arena.destroyOnReset([](void* p) { static_cast<T*>(p)->~T(); }, object);
+  }
+  return object;
+}
+
+} // namespace dui
+
+#endif // DUI_FRAME_ARENA_HPP_
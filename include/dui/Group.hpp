@@ -18,9 +18,10 @@ namespace dui {
 class Group : public Targetable<Group>
 {
   Target parent;
-  std::string_view id;
+  Id id;
   bool locked = false;
   bool ended = false;
+  bool clip = true;
   SDL_Rect rect;
   SDL_Point topLeft;
   SDL_Point bottomRight;
@@ -42,12 +43,14 @@ public:
    * @param id the group id
    * @param rect the rect. Either w or h being 0 means it will auto size
    * @param style
+   * @param clip if false its elements are not clipped by its rect
    */
   Group(Target parent,
-        std::string_view id,
+        Id id,
         const SDL_Point& scrollOffset,
         const SDL_Rect& rect,
-        const GroupStyle& style);
+        const GroupStyle& style,
+        bool clip = true);
 
   ~Group()
   {
@@ -103,7 +106,7 @@ public:
  */
 inline Group
 group(Target target,
-      std::string_view id,
+      Id id,
       const SDL_Rect& r = {0},
       const GroupStyle& style = themeFor<Group>())
 {
@@ -114,7 +117,7 @@ group(Target target,
 /// @ingroup groups
 inline Group
 group(Target target,
-      std::string_view id,
+      Id id,
       const SDL_Rect& r,
       Layout layout,
       const GroupStyle& style = themeFor<Group>())
@@ -122,11 +125,45 @@ group(Target target,
   return group(target, id, r, style.withLayout(layout));
 }
 
+/**
+ * @brief Create group that does not clip its elements
+ * @ingroup groups
+ *
+ * Meant for decoration only groups, where all elements are known to be inside
+ * it, as it spares the clip rect changes when rendering.
+ *
+ * @param target the parent group or frame
+ * @param id the group id
+ * @param r the group dimensions
+ * @param style the group style
+ * @return Group
+ */
+inline Group
+unclippedGroup(Target target,
+               Id id,
+               const SDL_Rect& r = {0},
+               const GroupStyle& style = themeFor<Group>())
+{
+  return {target, id, {0, 0}, r, style, false};
+}
+
+/// @copydoc unclippedGroup
+/// @ingroup groups
+inline Group
+unclippedGroup(Target target,
+               Id id,
+               const SDL_Rect& r,
+               Layout layout,
+               const GroupStyle& style = themeFor<Group>())
+{
+  return unclippedGroup(target, id, r, style.withLayout(layout));
+}
+
 /// @copydoc group
 /// @ingroup groups
 inline Group
 offsetGroup(Target target,
-            std::string_view id,
+            Id id,
             const SDL_Point& scrollOffset,
             const SDL_Rect& r,
             const GroupStyle& style = themeFor<Group>())
@@ -138,7 +175,7 @@ offsetGroup(Target target,
 /// @ingroup groups
 inline Group
 offsetGroup(Target target,
-            std::string_view id,
+            Id id,
             const SDL_Point& scrollOffset,
             const SDL_Rect& r,
             Layout layout,
@@ -148,18 +185,20 @@ offsetGroup(Target target,
 }
 
 inline Group::Group(Target parent,
-                    std::string_view id,
+                    Id id,
                     const SDL_Point& scroll,
                     const SDL_Rect& rect,
-                    const GroupStyle& style)
+                    const GroupStyle& style,
+                    bool clip)
   : parent(parent)
   , id(id)
+  , clip(clip)
   , rect(rect)
   , topLeft(makeCaret(parent.getCaret(), rect.x - scroll.x, rect.y - scroll.y))
   , bottomRight(topLeft)
   , style(style)
 {
-  parent.lock(id, rect);
+  parent.lock(id, rect, clip);
 }
 
 inline void
@@ -172,7 +211,7 @@ Group::end()
   if (rect.h == 0) {
     rect.h = height();
   }
-  parent.unlock(id, rect);
+  parent.unlock(id, rect, clip);
   parent.advance({rect.x + rect.w, rect.y + rect.h});
   ended = true;
   parent = {};
@@ -181,6 +220,7 @@ Group::end()
 inline Group::Group(Group&& rhs)
   : parent(rhs.parent)
   , id(std::move(rhs.id))
+  , clip(rhs.clip)
   , rect(rhs.rect)
   , topLeft(rhs.topLeft)
   , bottomRight(rhs.bottomRight)
@@ -0,0 +1,167 @@
+#ifndef DUI_HIT_INDEX_HPP_
+#define DUI_HIT_INDEX_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+#include <SDL.h>
+
+namespace dui {
+
+/**
+ * @brief Finds the topmost element at a point
+ *
+ * The element rects are added during a frame, topmost first, which is the
+ * order the elements themselves are added (the display list is rendered
+ * backwards). build() then sorts them into a uniform grid, so find() only
+ * tests the few rects overlapping the point's cell, however many elements
+ * there are.
+ *
+ * After the first frames it does no allocations, as all buffers are kept.
+ */
+class HitIndex
+{
+  static constexpr int MAX_CELLS = 64; ///< On each axis
+  static constexpr int MIN_CELL_SIZE = 16;
+
+  struct Hit
+  {
+    Uint64 id;
+    SDL_Rect rect;
+  };
+  std::vector<Hit> pending;      ///< Added since the last build()
+  std::vector<Hit> hits;         ///< Of the last build()
+  std::vector<Uint32> cellStart; ///< Start of each cell on cellHits, and end
+  std::vector<Uint32> cellHits;  ///< Indices on hits, topmost first
+  SDL_Rect bounds{0};
+  int cellW = 1;
+  int cellH = 1;
+  int columns = 0;
+
+public:
+  /// Add an element, below the ones added before. Empty rects are ignored
+  void add(Uint64 id, const SDL_Rect& rect)
+  {
+    if (!SDL_RectEmpty(&rect)) {
+      pending.push_back({id, rect});
+    }
+  }
+
+  /// Add the elements pending on other, below the ones here, and clear them
+  void take(HitIndex& other)
+  {
+    pending.insert(pending.end(), other.pending.begin(), other.pending.end());
+    other.pending.clear();
+  }
+
+  /// Number of elements added since the last build()
+  size_t getPendingCount() const { return pending.size(); }
+
+  /// If the element was added since the last build()
+  bool isPending(Uint64 id) const
+  {
+    return std::any_of(pending.begin(), pending.end(), [&](const Hit& hit) {
+      return hit.id == id;
+    });
+  }
+
+  /**
+   * @brief Add copies of the elements pending on other, from the first on,
+   * below the ones here
+   */
+  void copyPending(const HitIndex& other, size_t first = 0)
+  {
+    pending.insert(
+      pending.end(), other.pending.begin() + first, other.pending.end());
+  }
+
+  /// Remove the elements added since the last build()
+  void clearPending() { pending.clear(); }
+
+  /// Replace the index with the elements added since the last build()
+  void build();
+
+  /// The topmost element containing p on the last build(), or 0 if none
+  Uint64 find(const SDL_Point& p) const;
+
+  /// Number of elements on the last build()
+  size_t size() const { return hits.size(); }
+
+private:
+  /// Call func(cell) for each cell overlapping r
+  template<class FUNC>
+  void forEachCell(const SDL_Rect& r, FUNC func) const;
+};
+
+inline void
+HitIndex::build()
+{
+  hits.swap(pending);
+  pending.clear();
+  cellHits.clear();
+  if (hits.empty()) {
+    cellStart.clear();
+    columns = 0;
+    return;
+  }
+  bounds = hits[0].rect;
+  for (auto& hit : hits) {
+    SDL_UnionRect(&bounds, &hit.rect, &bounds);
+  }
+
+  // Square cells with about one element each, unless too many or too small
+  int side = int(std::sqrt(double(bounds.w) * bounds.h / hits.size()));
+  side = std::max(side, MIN_CELL_SIZE);
+  columns = std::clamp((bounds.w + side - 1) / side, 1, MAX_CELLS);
+  int rows = std::clamp((bounds.h + side - 1) / side, 1, MAX_CELLS);
+  cellW = (bounds.w + columns - 1) / columns;
+  cellH = (bounds.h + rows - 1) / rows;
+
+  // Counting sort, so each cell keeps the elements in order
+  cellStart.assign(columns * rows + 1, 0);
+  for (auto& hit : hits) {
+    forEachCell(hit.rect, [&](int cell) { ++cellStart[cell]; });
+  }
+  std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+  cellHits.resize(cellStart.back());
+  for (Uint32 i = hits.size(); i-- > 0;) {
+    forEachCell(hits[i].rect,
+                [&](int cell) { cellHits[--cellStart[cell]] = i; });
+  }
+}
+
+inline Uint64
+HitIndex::find(const SDL_Point& p) const
+{
+  if (columns == 0 || !SDL_PointInRect(&p, &bounds)) {
+    return 0;
+  }
+  int cell = (p.y - bounds.y) / cellH * columns + (p.x - bounds.x) / cellW;
+  for (Uint32 i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+    auto& hit = hits[cellHits[i]];
+    if (SDL_PointInRect(&p, &hit.rect)) {
+      return hit.id;
+    }
+  }
+  return 0;
+}
+
+template<class FUNC>
+inline void
+HitIndex::forEachCell(const SDL_Rect& r, FUNC func) const
+{
+  int x0 = (r.x - bounds.x) / cellW;
+  int x1 = (r.x + r.w - 1 - bounds.x) / cellW;
+  int y0 = (r.y - bounds.y) / cellH;
+  int y1 = (r.y + r.h - 1 - bounds.y) / cellH;
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      func(y * columns + x);
+    }
+  }
+}
+
+} // namespace dui
+
+#endif // DUI_HIT_INDEX_HPP_
@@ -0,0 +1,129 @@
+#ifndef DUI_ID_HPP_
+#define DUI_ID_HPP_
+
+#include <string>
+#include <string_view>
+#include <SDL.h>
+
+namespace dui {
+
+/// The hash of the root, where the frame's elements are
+constexpr Uint64 ROOT_ID = 0xcbf29ce484222325;
+
+/// FNV-1a hash of str, continuing from hash
+constexpr Uint64
+hashString(std::string_view str, Uint64 hash = ROOT_ID)
+{
+  for (auto ch : str) {
+    hash = (hash ^ Uint8(ch)) * 0x100000001b3;
+  }
+  return hash;
+}
+
+/**
+ * @brief Combine the hash of a group with the local hash of an element in it
+ *
+ * The result is never 0, so it can be used as "no element".
+ */
+constexpr Uint64
+combineId(Uint64 parent, Uint64 local)
+{
+  Uint64 hash = (parent ^ (local + 0x9e3779b97f4a7c15 + (parent << 6) +
+                           (parent >> 2))) *
+                0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  return hash ? hash : 1;
+}
+
+/**
+ * @brief Identifies an element inside its group
+ *
+ * It is usually made implicitly from the element name, but it can also mix an
+ * index into the name, for elements created in loops, or take a hash computed
+ * beforehand. Neither allocates nor formats anything.
+ *
+ * Only the hash is needed after the element is added, so the name does not
+ * need to outlive it.
+ */
+class Id
+{
+  Uint64 hash = 0;
+  std::string_view name;
+#ifdef DUI_DEBUG_IDS
+  Uint64 index = 0;
+  bool indexed = false;
+#endif
+
+public:
+  /// An empty id
+  constexpr Id() = default;
+
+  /// Id from a name. An empty name makes an empty id
+  constexpr Id(std::string_view name)
+    : hash(name.empty() ? 0 : hashString(name))
+    , name(name)
+  {}
+
+  /// @copydoc Id(std::string_view)
+  constexpr Id(const char* name)
+    : Id(std::string_view{name})
+  {}
+
+  /// @copydoc Id(std::string_view)
+  Id(const std::string& name)
+    : Id(std::string_view{name})
+  {}
+
+  /**
+   * @brief Id from a base name and an index
+   *
+   * Use it for the elements created in a loop, like the rows of a list,
+   * instead of formatting a different name for each.
+   */
+  constexpr Id(std::string_view base, Uint64 index)
+    : hash(combineId(hashString(base), index))
+    , name(base)
+#ifdef DUI_DEBUG_IDS
+    , index(index)
+    , indexed(true)
+#endif
+  {}
+
+  /// Id from a hash computed beforehand, for example with hashString()
+  static constexpr Id fromHash(Uint64 hash)
+  {
+    Id id;
+    id.hash = hash;
+    return id;
+  }
+
+  /// The hash, 0 if empty
+  constexpr Uint64 getHash() const { return hash; }
+
+  /// The name or base name, empty if made from a hash
+  constexpr std::string_view getName() const { return name; }
+
+  /// If empty
+  constexpr bool empty() const { return hash == 0; }
+
+#ifdef DUI_DEBUG_IDS
+  /// Append a readable form to str
+  void appendTo(std::string& str) const
+  {
+    if (name.empty()) {
+      str += '#';
+      str += std::to_string(hash);
+      return;
+    }
+    str += name;
+    if (indexed) {
+      str += '#';
+      str += std::to_string(index);
+    }
+  }
+#endif
+};
+
+} // namespace dui
+
+#endif // DUI_ID_HPP_
@@ -1,6 +1,8 @@
 #ifndef DUI_INPUTBOX_HPP
 #define DUI_INPUTBOX_HPP
 
+#include <memory_resource>
+#include <string>
 #include <string_view>
 #include "Element.hpp"
 #include "Group.hpp"
@@ -51,23 +53,31 @@ struct TextChange
   size_t erase;            ///< number of bytes to dele before inserting
 };
 
+/// The cursor of an input box
+struct TextCursor
+{
+  size_t pos = 0; ///< Where text is inserted
+  size_t max = 0; ///< The text length
+};
+
 /// Base for input boxes
 inline TextChange
 textBoxBase(Target target,
-            std::string_view id,
+            Id id,
             std::string_view value,
             SDL_Rect r,
             const InputBoxStyle& style = themeFor<InputBoxBase>())
 {
-  static size_t cursorPos = 0;
-  static size_t maxPos = 0;
+  auto& cursor = target.getCached<TextCursor>(id);
+  auto& cursorPos = cursor.pos;
+  auto& maxPos = cursor.max;
   r = makeInputRect(r, style);
   if (target.checkMouse(id, r) == MouseAction::GRAB) {
     maxPos = cursorPos = value.size();
   }
 
-  auto action = target.checkText(id);
-  bool active = action == TextAction::NONE ? target.isActive(id) : true;
+  auto events = target.textEvents(id);
+  bool active = !events.empty() || target.isActive(id);
   if (active && cursorPos > value.size()) {
     maxPos = cursorPos = value.size();
   }
@@ -92,26 +102,35 @@ textBoxBase(Target target,
   }
   text(g, value, {-deltaX, 0}, {style.font, currentColors.text, style.scale});
 
-  if (active && (target.getState().ticks() / 512) % 2) {
+  auto ticks = target.getState().ticks();
+  if (active) {
+    // Blink
+    target.getState().wakeAt((ticks / 512 + 1) * 512);
+  }
+  if (active && (ticks / 512) % 2) {
     // Show cursor
     colorBox(
       g, {int(cursorPos) * 8 - deltaX, 0, 1, clientSz.y}, currentColors.text);
   }
-  if (action == TextAction::INPUT) {
-    auto insert = target.lastText();
-    auto index = cursorPos;
-    cursorPos += insert.size();
-    maxPos += insert.size();
-    return {insert, index, 0};
+  if (events.empty()) {
+    return {};
   }
-  if (action == TextAction::KEYDOWN) {
-    SDL_Keysym keysym = target.lastKeyDown();
-    switch (keysym.sym) {
+
+  // Apply all events to a copy, then return the difference as a single change
+  auto resource = target.getState().getFrameResource();
+  std::pmr::string edited{value, resource};
+  for (auto& ev : events) {
+    if (ev.action == TextAction::INPUT) {
+      std::string_view insert{ev.text};
+      edited.insert(cursorPos, insert);
+      cursorPos += insert.size();
+      continue;
+    }
+    switch (ev.keysym.sym) {
       case SDLK_BACKSPACE:
-        if (!value.empty()) {
+        if (cursorPos > 0) {
           cursorPos -= 1;
-          maxPos -= 1;
-          return {{}, cursorPos, 1};
+          edited.erase(cursorPos, 1);
         }
         break;
       case SDLK_LEFT:
@@ -120,7 +139,7 @@ textBoxBase(Target target,
         }
         break;
       case SDLK_RIGHT:
-        if (cursorPos < maxPos) {
+        if (cursorPos < edited.size()) {
           cursorPos += 1;
         }
         break;
@@ -128,14 +147,34 @@ textBoxBase(Target target,
         break;
     }
   }
-  return {};
+  maxPos = edited.size();
+
+  size_t common = std::min(value.size(), edited.size());
+  size_t prefix = 0;
+  while (prefix < common && value[prefix] == edited[prefix]) {
+    ++prefix;
+  }
+  size_t suffix = 0;
+  while (suffix < common - prefix &&
+         value.rbegin()[suffix] == edited.rbegin()[suffix]) {
+    ++suffix;
+  }
+  size_t erase = value.size() - prefix - suffix;
+  size_t insertSize = edited.size() - prefix - suffix;
+  if (insertSize == 0) {
+    return {{}, prefix, erase};
+  }
+  // The copy might be on the stack, so keep the insert on the frame arena
+  auto insert = static_cast<char*>(resource->allocate(insertSize, 1));
+  SDL_memcpy(insert, edited.data() + prefix, insertSize);
+  return {{insert, insertSize}, prefix, erase};
 }
 
 /// A text box
 /// @ingroup elements
 inline bool
 textBox(Target target,
-        std::string_view id,
+        Id id,
         char* value,
         size_t maxSize,
         const SDL_Rect& r = {0},
@@ -172,7 +211,7 @@ textBox(Target target,
 /// @ingroup elements
 inline bool
 textBox(Target target,
-        std::string_view id,
+        Id id,
         std::string* value,
         const SDL_Rect& r = {0},
         const InputBoxStyle& style = themeFor<TextBox>())
@@ -189,7 +228,7 @@ textBox(Target target,
 class BufferedInputBox
 {
   Target target;
-  std::string_view id;
+  Id id;
   SDL_Rect rect;
   const InputBoxStyle& style;
 
@@ -202,11 +241,14 @@ public:
   static constexpr int BUF_SZ = 256; ///< Buffer size
   char buffer[BUF_SZ];               ///< Buffer
 
+  /// The text being edited, kept between frames
+  struct EditBuffer
+  {
+    char text[BUF_SZ]; ///< Text
+  };
+
   /// Ctor
-  BufferedInputBox(Target target,
-                   std::string_view id,
-                   SDL_Rect r,
-                   const InputBoxStyle& style)
+  BufferedInputBox(Target target, Id id, SDL_Rect r, const InputBoxStyle& style)
     : target(target)
     , id(id)
     , rect(makeInputRect(r, style))
@@ -215,13 +257,15 @@ public:
     bool clicked = target.checkMouse(id, rect) == MouseAction::GRAB;
     active = target.isActive(id);
     refillBuffer = !active || clicked;
-    if (active && target.checkText(id) == TextAction::KEYDOWN) {
-      auto keysym = target.lastKeyDown();
-      if (keysym.sym == SDLK_UP) {
-        incAmount = 1;
+    for (auto& ev : target.textEvents(id)) {
+      if (ev.action != TextAction::KEYDOWN) {
+        continue;
+      }
+      if (ev.keysym.sym == SDLK_UP) {
+        incAmount += 1;
         refillBuffer = true;
-      } else if (keysym.sym == SDLK_DOWN) {
-        incAmount = -1;
+      } else if (ev.keysym.sym == SDLK_DOWN) {
+        incAmount -= 1;
         refillBuffer = true;
       }
     }
@@ -242,7 +286,7 @@ public:
       textBox(target, id, buffer, BUF_SZ, rect, style);
       return false;
     }
-    static char editBuffer[BUF_SZ];
+    auto& editBuffer = target.getCached<EditBuffer>(id).text;
     if (refillBuffer) {
       SDL_strlcpy(editBuffer, buffer, BUF_SZ);
     }
@@ -258,7 +302,7 @@ public:
 /// @ingroup elements
 inline bool
 numberBox(Target target,
-          std::string_view id,
+          Id id,
           int* value,
           SDL_Rect r = {0},
           const InputBoxStyle& style = themeFor<IntBox>())
@@ -285,7 +329,7 @@ numberBox(Target target,
 /// @ingroup elements
 inline bool
 numberBox(Target target,
-          std::string_view id,
+          Id id,
           double* value,
           SDL_Rect r = {0},
           const InputBoxStyle& style = themeFor<DoubleBox>())
@@ -318,7 +362,7 @@ numberBox(Target target,
 /// @ingroup elements
 inline bool
 numberBox(Target target,
-          std::string_view id,
+          Id id,
           float* value,
           SDL_Rect r = {0},
           const InputBoxStyle& style = themeFor<FloatBox>())
@@ -30,7 +30,7 @@ labeledGroup(Target target,
 /// @ingroup elements
 inline bool
 textField(Target target,
-          std::string_view id,
+          Id id,
           std::string_view labelText,
           char* value,
           size_t maxSize,
@@ -59,7 +59,7 @@ textField(Target target,
 /// @ingroup elements
 inline bool
 textField(Target target,
-          std::string_view id,
+          Id id,
           std::string_view labelText,
           std::string* value,
           const SDL_Point& p = {0},
@@ -86,7 +86,7 @@ textField(Target target,
 /// @ingroup elements
 inline bool
 numberField(Target target,
-            std::string_view id,
+            Id id,
             std::string_view labelText,
             int* value,
             const SDL_Point& p = {0},
@@ -113,7 +113,7 @@ numberField(Target target,
 /// @ingroup elements
 inline bool
 numberField(Target target,
-            std::string_view id,
+            Id id,
             std::string_view labelText,
             double* value,
             const SDL_Point& p = {0},
@@ -140,7 +140,7 @@ numberField(Target target,
 /// @ingroup elements
 inline bool
 numberField(Target target,
-            std::string_view id,
+            Id id,
             std::string_view labelText,
             float* value,
             const SDL_Point& p = {0},
@@ -0,0 +1,150 @@
+#ifndef DUI_INPUT_QUEUE_HPP_
+#define DUI_INPUT_QUEUE_HPP_
+
+#include <SDL.h>
+
+namespace dui {
+
+/**
+ * @brief A bounded ring buffer of input events
+ *
+ * State queues the events it gets between frames here, so none is lost when
+ * several arrive before a frame. Consecutive mouse motions are coalesced into
+ * the last one, and consecutive text inputs into a single event while the text
+ * fits, so it only fills up if the frames stop altogether. When full, new
+ * events are dropped, except mouse button ones, that take the place of the
+ * latest other event instead, so no button ends up stuck as pressed.
+ */
+class InputQueue
+{
+public:
+  static constexpr size_t CAPACITY = 64; ///< Max events queued
+
+private:
+  SDL_Event events[CAPACITY];
+  size_t first = 0;
+  size_t count = 0;
+
+public:
+  /// Add ev to the end, coalescing it with the last one if possible
+  void push(const SDL_Event& ev);
+
+  /// The first event. The queue must not be empty
+  const SDL_Event& front() const
+  {
+    SDL_assert(count > 0);
+    return events[first];
+  }
+
+  /// Remove the first event. The queue must not be empty
+  void pop()
+  {
+    SDL_assert(count > 0);
+    first = (first + 1) % CAPACITY;
+    count -= 1;
+  }
+
+  /// If there is any event of the given type
+  bool contains(Uint32 type) const;
+
+  /// Number of events
+  size_t size() const { return count; }
+
+  /// If there are no events
+  bool empty() const { return count == 0; }
+
+  /// Remove all events
+  void clear() { first = count = 0; }
+
+private:
+  SDL_Event& at(size_t index) { return events[(first + index) % CAPACITY]; }
+
+  static bool isButton(const SDL_Event& ev)
+  {
+    return ev.type == SDL_MOUSEBUTTONDOWN || ev.type == SDL_MOUSEBUTTONUP;
+  }
+
+  /// Remove an event to make room for the button event ev
+  void makeRoom(const SDL_Event& ev);
+
+  /// Remove the event at index, keeping the order of the others
+  void erase(size_t index);
+};
+
+inline void
+InputQueue::push(const SDL_Event& ev)
+{
+  if (count > 0) {
+    auto& last = events[(first + count - 1) % CAPACITY];
+    if (ev.type == SDL_MOUSEMOTION && last.type == SDL_MOUSEMOTION) {
+      last = ev;
+      return;
+    }
+    if (ev.type == SDL_TEXTINPUT && last.type == SDL_TEXTINPUT) {
+      auto len = SDL_strlen(last.text.text);
+      auto size = sizeof(last.text.text) - len;
+      if (SDL_strlen(ev.text.text) < size) {
+        SDL_strlcpy(last.text.text + len, ev.text.text, size);
+        return;
+      }
+    }
+  }
+  if (count == CAPACITY) {
+    if (!isButton(ev)) {
+      return;
+    }
+    makeRoom(ev);
+  }
+  events[(first + count) % CAPACITY] = ev;
+  count += 1;
+}
+
+inline void
+InputQueue::makeRoom(const SDL_Event& ev)
+{
+  for (size_t i = count; i-- > 0;) {
+    if (!isButton(at(i))) {
+      erase(i);
+      return;
+    }
+  }
+  // All are button events, so we drop the oldest one followed by another of
+  // the same button, that decides if it ends up pressed. With only a few
+  // buttons there is always one
+  for (size_t i = 0; i < count; ++i) {
+    bool followed = at(i).button.button == ev.button.button;
+    for (size_t j = i + 1; j < count && !followed; ++j) {
+      followed = at(i).button.button == at(j).button.button;
+    }
+    if (followed) {
+      erase(i);
+      return;
+    }
+  }
+  erase(0);
+}
+
+inline void
+InputQueue::erase(size_t index)
+{
+  SDL_assert(index < count);
+  for (size_t i = index; i + 1 < count; ++i) {
+    at(i) = at(i + 1);
+  }
+  count -= 1;
+}
+
+inline bool
+InputQueue::contains(Uint32 type) const
+{
+  for (size_t i = 0; i < count; ++i) {
+    if (events[(first + i) % CAPACITY].type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace dui
+
+#endif // DUI_INPUT_QUEUE_HPP_
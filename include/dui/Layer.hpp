@@ -0,0 +1,67 @@
+#ifndef DUI_LAYER_HPP_
+#define DUI_LAYER_HPP_
+
+#include <SDL.h>
+#include "State.hpp"
+#include "Target.hpp"
+
+namespace dui {
+
+/**
+ * @brief Keeps a layer open while it lives, see State.beginLayer()
+ *
+ * Used by wrapper elements like panel() and window() when their style asks to
+ * be cached. It must be declared before the members that add the elements, so
+ * it begins before and ends after them.
+ */
+class Layer
+{
+  State* state = nullptr;
+
+public:
+  /// Ctor that does nothing
+  Layer() = default;
+
+  /**
+   * @brief Ctor
+   *
+   * @param parent the target the layer is added to
+   * @param id the layer id, usually the same as the element's
+   * @param enabled if false it does nothing
+   */
+  Layer(Target parent, Id id, bool enabled)
+  {
+    if (enabled) {
+      state = &parent.getState();
+      state->beginLayer(id);
+    }
+  }
+  Layer(const Layer&) = delete;
+  Layer(Layer&& rhs)
+    : state(rhs.state)
+  {
+    rhs.state = nullptr;
+  }
+  Layer& operator=(const Layer&) = delete;
+  Layer& operator=(Layer&& rhs) = delete;
+
+  ~Layer()
+  {
+    if (state) {
+      end();
+    }
+  }
+
+  /// End the layer, if enabled and not ended yet
+  void end()
+  {
+    if (state) {
+      state->endLayer();
+      state = nullptr;
+    }
+  }
+};
+
+} // namespace dui
+
+#endif // DUI_LAYER_HPP_
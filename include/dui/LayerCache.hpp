@@ -0,0 +1,246 @@
+#ifndef DUI_LAYER_CACHE_HPP_
+#define DUI_LAYER_CACHE_HPP_
+
+#include <vector>
+#include <SDL.h>
+#include "DisplayList.hpp"
+
+namespace dui {
+
+/**
+ * @brief Keeps the layers of a display list rendered on textures
+ *
+ * Before a list is rendered, prepare() renders each of its layers (see
+ * DisplayList.insertLayer()) to a texture of its own, unless the texture
+ * already has the same content, and the list then draws it as a single
+ * shape. A layer whose content did not change costs a single draw, however
+ * many elements it has.
+ *
+ * The textures are pooled: the ones not used for a frame are reused by new
+ * layers of the same size or, when the total would exceed getBudget(),
+ * destroyed, least recently used first. A layer that still doesn't fit, or
+ * any layer if the renderer does not support render targets, is just
+ * rendered as part of the list.
+ *
+ * It owns textures of the renderer, see RenderThread for the thread to use it
+ * on.
+ */
+class LayerCache
+{
+  static constexpr Uint32 MAX_AGE = 60; ///< Frames an unused texture is kept
+
+  struct Entry
+  {
+    Uint64 key;
+    SDL_Texture* texture;
+    int w;
+    int h;
+    Uint64 fingerprint; ///< Of the content rendered on texture, or 0
+    Uint32 lastUsed;
+  };
+  std::vector<Entry> entries;
+  Uint32 frame = 0;
+  size_t budget = 64 << 20;
+  size_t usage = 0;
+
+public:
+  /// Ctor
+  LayerCache() = default;
+
+  LayerCache(const LayerCache&) = delete;
+  LayerCache& operator=(const LayerCache&) = delete;
+
+  ~LayerCache() { clear(); }
+
+  /**
+   * @brief Render the changed layers of list and assign them their textures
+   *
+   * Call it right before rendering the list. It changes the render target, so
+   * it must not be called while rendering to a texture.
+   */
+  void prepare(SDL_Renderer* renderer, const DisplayList& list);
+
+  /**
+   * @brief Render all layers again on the next prepare()
+   *
+   * For when the textures lost their contents, like after a
+   * SDL_RENDER_TARGETS_RESET. After a SDL_RENDER_DEVICE_RESET the textures
+   * themselves are gone, so use clear() instead.
+   */
+  void invalidate()
+  {
+    for (auto& entry : entries) {
+      entry.fingerprint = 0;
+    }
+  }
+
+  /// Destroy all textures
+  void clear()
+  {
+    for (auto& entry : entries) {
+      SDL_DestroyTexture(entry.texture);
+    }
+    entries.clear();
+    usage = 0;
+  }
+
+  /// Max bytes of texture memory used, 64 MiB by default
+  size_t getBudget() const { return budget; }
+
+  /**
+   * @brief Set the max bytes of texture memory used
+   *
+   * It takes effect as textures are needed, call clear() to free them now.
+   */
+  void setBudget(size_t value) { budget = value; }
+
+  /// Bytes of texture memory used, estimated at 4 per pixel
+  size_t getUsage() const { return usage; }
+
+  /// Number of textures
+  size_t size() const { return entries.size(); }
+
+private:
+  static size_t bytes(int w, int h) { return size_t(w) * size_t(h) * 4; }
+
+  void prepareLayers(SDL_Renderer* renderer, const DisplayList& list);
+
+  /// An entry for key with a texture of the given size, or nullptr
+  Entry* acquire(SDL_Renderer* renderer, Uint64 key, int w, int h);
+
+  /// If it was not used on this frame or the last one
+  bool isFree(const Entry& entry) const { return frame - entry.lastUsed > 1; }
+
+  void destroy(size_t index)
+  {
+    SDL_DestroyTexture(entries[index].texture);
+    usage -= bytes(entries[index].w, entries[index].h);
+    entries[index] = entries.back();
+    entries.pop_back();
+  }
+};
+
+inline void
+LayerCache::prepare(SDL_Renderer* renderer, const DisplayList& list)
+{
+  ++frame;
+  for (size_t i = 0; i < entries.size();) {
+    if (frame - entries[i].lastUsed > MAX_AGE) {
+      destroy(i);
+    } else {
+      ++i;
+    }
+  }
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) < 0 ||
+      !(info.flags & SDL_RENDERER_TARGETTEXTURE)) {
+    return;
+  }
+  prepareLayers(renderer, list);
+}
+
+inline void
+LayerCache::prepareLayers(SDL_Renderer* renderer, const DisplayList& list)
+{
+  for (auto& layer : list.layers) {
+    layer.texture = nullptr;
+    auto& content = *layer.content;
+    // The inner ones first, so this draws their textures
+    prepareLayers(renderer, content);
+
+    int w = content.bounds.w;
+    int h = content.bounds.h;
+    Entry* entry = nullptr;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].key != layer.key) {
+        continue;
+      }
+      if (entries[i].w == w && entries[i].h == h) {
+        entry = &entries[i];
+      } else {
+        destroy(i);
+      }
+      break;
+    }
+    if (!entry) {
+      entry = acquire(renderer, layer.key, w, h);
+      if (!entry) {
+        continue;
+      }
+    }
+    entry->lastUsed = frame;
+    if (entry->fingerprint != content.fingerprint) {
+      auto target = SDL_GetRenderTarget(renderer);
+      if (SDL_SetRenderTarget(renderer, entry->texture) < 0) {
+        continue;
+      }
+      Uint8 r, g, b, a;
+      SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+      SDL_RenderClear(renderer);
+      content.render(renderer, nullptr, {-content.bounds.x, -content.bounds.y});
+      SDL_SetRenderTarget(renderer, target);
+      SDL_SetRenderDrawColor(renderer, r, g, b, a);
+      entry->fingerprint = content.fingerprint;
+    }
+    layer.texture = entry->texture;
+  }
+}
+
+inline LayerCache::Entry*
+LayerCache::acquire(SDL_Renderer* renderer, Uint64 key, int w, int h)
+{
+  size_t size = bytes(w, h);
+  if (size > budget) {
+    return nullptr;
+  }
+  for (auto& entry : entries) {
+    if (isFree(entry) && entry.w == w && entry.h == h) {
+      entry.key = key;
+      entry.fingerprint = 0;
+      return &entry;
+    }
+  }
+  while (usage + size > budget) {
+    size_t oldest = entries.size();
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (isFree(entries[i]) &&
+          (oldest == entries.size() ||
+           entries[i].lastUsed < entries[oldest].lastUsed)) {
+        oldest = i;
+      }
+    }
+    if (oldest == entries.size()) {
+      return nullptr;
+    }
+    destroy(oldest);
+  }
+
+  auto texture = SDL_CreateTexture(
+    renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+  if (!texture) {
+    return nullptr;
+  }
+  // The content is blended over transparent black, so its colors end up
+  // premultiplied by their alpha
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+  auto premultiplied =
+    SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+                               SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                               SDL_BLENDOPERATION_ADD,
+                               SDL_BLENDFACTOR_ONE,
+                               SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                               SDL_BLENDOPERATION_ADD);
+  if (SDL_SetTextureBlendMode(texture, premultiplied) < 0) {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  }
+#else
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+#endif
+  usage += size;
+  return &entries.emplace_back(Entry{key, texture, w, h, 0, frame});
+}
+
+} // namespace dui
+
+#endif // DUI_LAYER_CACHE_HPP_
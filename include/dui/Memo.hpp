@@ -0,0 +1,127 @@
+#ifndef DUI_MEMO_HPP_
+#define DUI_MEMO_HPP_
+
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include "Group.hpp"
+#include "GroupStyle.hpp"
+#include "Target.hpp"
+
+namespace dui {
+
+/**
+ * @brief Hash of a memo() dependency, continuing from hash
+ *
+ * Strings are hashed by their contents, anything else trivially copyable by
+ * its bytes. These include any padding, so equal structs with padding may
+ * hash differently and rebuild the memo needlessly; pass their fields instead.
+ */
+template<class T>
+inline Uint64
+hashDependency(Uint64 hash, const T& value)
+{
+  if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    return combineId(hash, hashString(std::string_view{value}));
+  } else {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "The dependency must be a string or trivially copyable");
+    std::string_view bytes{reinterpret_cast<const char*>(&value), sizeof(T)};
+    return combineId(hash, hashString(bytes));
+  }
+}
+
+/// A memo class @see memo()
+class MemoImpl : public Targetable<MemoImpl>
+{
+  Target parent;
+  std::optional<Group> group; ///< Only if it is being built
+
+public:
+  /// Ctor
+  MemoImpl(Target parent, Id id, Uint64 deps, const GroupStyle& style)
+    : parent(parent)
+  {
+    SDL_Point size;
+    if (parent.getState().beginMemo(id, parent.getCaret(), deps, &size)) {
+      group.emplace(parent, id, SDL_Point{0, 0}, SDL_Rect{0}, style);
+    } else {
+      parent.advance(size);
+    }
+  }
+  /// Move ctor
+  MemoImpl(MemoImpl&& rhs)
+    : parent(rhs.parent)
+    , group(std::move(rhs.group))
+  {}
+
+  /// Move assignment operator
+  MemoImpl& operator=(MemoImpl&& rhs)
+  {
+    this->~MemoImpl();
+    new (this) MemoImpl(std::move(rhs));
+    return *this;
+  }
+
+  ~MemoImpl()
+  {
+    if (*this) {
+      end();
+    }
+  }
+
+  /// Finishes the memo, recording it for the next frames
+  void end()
+  {
+    SDL_assert(*this);
+    SDL_Point size{group->width(), group->height()};
+    group->end();
+    parent.getState().endMemo(size);
+  }
+
+  /// Returns a target object to this
+  operator Target() &
+  {
+    SDL_assert(group);
+    return *group;
+  }
+
+  /// Returns true if it is being built and can accept elements
+  operator bool() const { return group && *group; }
+};
+
+/**
+ * @brief adds a memo, a group built only when something it depends on changes
+ * @ingroup groups
+ *
+ * Otherwise it replays what it added on the last frame it was built, without
+ * running your code, which is false when tested:
+ *
+ * ```cpp
+ * if (auto m = dui::memo(f, "stats", count, name)) {
+ *   // Only runs when count or name changed
+ * }
+ * ```
+ *
+ * It is also built while the mouse is over it or anything inside it is
+ * grabbed or active, so its elements react to input as usual. The elements
+ * must depend on nothing but the deps, the memo position and the current
+ * font. It is auto sized, with the default group style.
+ *
+ * @param target the parent group or frame
+ * @param id the memo id
+ * @param deps the values its elements depend on, see hashDependency()
+ * @return MemoImpl
+ */
+template<class... DEPS>
+inline MemoImpl
+memo(Target target, Id id, const DEPS&... deps)
+{
+  Uint64 hash = ROOT_ID;
+  ((hash = hashDependency(hash, deps)), ...);
+  return {target, id, hash, themeFor<Group>()};
+}
+
+} // namespace dui
+
+#endif // DUI_MEMO_HPP_
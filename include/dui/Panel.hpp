@@ -4,6 +4,7 @@
 #include <string_view>
 #include "Element.hpp"
 #include "Group.hpp"
+#include "Layer.hpp"
 #include "PanelStyle.hpp"
 #include "Wrapper.hpp"
 
@@ -14,22 +15,25 @@ template<class CLIENT>
 class PanelImpl : public Targetable<PanelImpl<CLIENT>>
 {
   PanelDecorationStyle style;
+  Layer layer; ///< Before wrapper, so it encloses it
   Wrapper<CLIENT> wrapper;
 
 public:
   /// Ctor
   template<class FUNC>
   PanelImpl(Target parent,
-            std::string_view id,
+            Id id,
             const SDL_Rect& r,
             FUNC initializer,
             const PanelDecorationStyle& style)
     : style(style)
+    , layer(parent, id, style.cached)
     , wrapper(parent, id, r, style.padding + style.border, initializer)
   {}
   /// Move ctor
   PanelImpl(PanelImpl&& rhs)
     : style(rhs.style)
+    , layer(std::move(rhs.layer))
     , wrapper(std::move(rhs.wrapper))
   {}
 
@@ -55,6 +59,7 @@ public:
     auto sz = wrapper.endClient();
     box(*this, {0, 0, sz.x, sz.y}, style);
     wrapper.end();
+    layer.end();
   }
 
   /// Return a target element for this
@@ -98,7 +103,7 @@ makePanelRect(const SDL_Rect& r, Target target)
  */
 inline PanelImpl<Group>
 panel(Target target,
-      std::string_view id,
+      Id id,
       const SDL_Rect& r = {0},
       const PanelStyle& style = themeFor<Panel>())
 {
@@ -114,7 +119,7 @@ panel(Target target,
 /// @ingroup groups
 inline PanelImpl<Group>
 panel(Target target,
-      std::string_view id,
+      Id id,
       const SDL_Rect& r,
       Layout layout,
       const PanelStyle& style = themeFor<Panel>())
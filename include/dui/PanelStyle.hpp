@@ -14,18 +14,20 @@ struct PanelDecorationStyle
   EdgeSize padding;
   EdgeSize border;
   BoxPaintStyle paint;
+  /// If true, it is kept on a texture between frames (see State.beginLayer())
+  bool cached = false;
 
   constexpr PanelDecorationStyle withPadding(const EdgeSize& padding) const
   {
-    return {padding, border, paint};
+    return {padding, border, paint, cached};
   }
   constexpr PanelDecorationStyle withBorderSize(const EdgeSize& border) const
   {
-    return {padding, border, paint};
+    return {padding, border, paint, cached};
   }
   constexpr PanelDecorationStyle withPaint(const BoxPaintStyle& paint) const
   {
-    return {padding, border, paint};
+    return {padding, border, paint, cached};
   }
   constexpr PanelDecorationStyle withBackgroundColor(SDL_Color background) const
   {
@@ -36,6 +38,10 @@ struct PanelDecorationStyle
   {
     return withPaint(paint.withBorder(border));
   }
+  constexpr PanelDecorationStyle withCached(bool cached) const
+  {
+    return {padding, border, paint, cached};
+  }
 
   constexpr operator BoxStyle() const { return {border, paint}; }
 };
@@ -78,6 +84,10 @@ struct PanelStyle
   {
     return withDecoration(decoration.withBorderColor(border));
   }
+  constexpr PanelStyle withCached(bool cached) const
+  {
+    return withDecoration(decoration.withCached(cached));
+  }
 
   constexpr PanelStyle withElementSpacing(int elementSpacing) const
   {
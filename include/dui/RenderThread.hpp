@@ -0,0 +1,180 @@
+#ifndef DUI_RENDER_THREAD_HPP_
+#define DUI_RENDER_THREAD_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <SDL.h>
+
+namespace dui {
+
+/**
+ * @brief A thread that runs the rendering tasks, in order
+ *
+ * Each posted task gets a fence, a number that grows with each post(). When a
+ * fence is done, its task and all posted before it have finished. State uses
+ * it to render a finished frame while the next one is built (see
+ * State.submit()).
+ *
+ * SDL renderers must only be used from one thread, so once you use one here,
+ * do everything involving it here too, through post() or call(). That
+ * includes creating and destroying it and its textures, as well as all the
+ * methods and the destructor of what owns them, like State, TextureAtlas and
+ * LayerCache. The one exception is building a State's frames, as they are
+ * only rendered with State.submit().
+ *
+ * A texture used by a submitted frame must stay valid and unchanged until the
+ * frame's fence is done. The simplest way is to destroy or update it with
+ * post(), as it only runs after the previous tasks.
+ */
+class RenderThread
+{
+  static constexpr size_t TASK_SIZE = 64;
+  static constexpr size_t QUEUE_SIZE = 8;
+
+  struct Task
+  {
+    void (*call)(void*);
+    alignas(std::max_align_t) unsigned char data[TASK_SIZE];
+  };
+  Task tasks[QUEUE_SIZE];
+
+  std::mutex mutex;
+  std::condition_variable wake; ///< Signals the thread
+  std::condition_variable done; ///< Signals the waiters
+  Uint64 posted = 0;            ///< Fence of the last posted task
+  Uint64 completed = 0;         ///< Fence of the last finished task
+  bool stopping = false;
+  std::thread thread;
+
+public:
+  /// Ctor
+  RenderThread()
+    : thread([this] { loop(); })
+  {}
+
+  RenderThread(const RenderThread&) = delete;
+  RenderThread& operator=(const RenderThread&) = delete;
+
+  /// Finish all posted tasks and stop
+  ~RenderThread();
+
+  /**
+   * @brief Run func() on the thread, after all tasks posted before
+   *
+   * The func is copied into a fixed slot, so it must be small and trivially
+   * destructible, like a lambda capturing a few references or pointers. If
+   * there are too many tasks pending, this waits for some to finish.
+   *
+   * @return the fence of this task
+   */
+  template<class FUNC>
+  Uint64 post(FUNC func);
+
+  /// Run func() on the thread and wait for it. See post()
+  template<class FUNC>
+  void call(FUNC func) { wait(post(std::move(func))); }
+
+  /**
+   * @brief Wait until the fence is done
+   *
+   * On the thread itself, it can only be called for the fences of previous
+   * tasks, that are always done.
+   */
+  void wait(Uint64 fence);
+
+  /// If the fence is done. The fence 0 is always done
+  bool isDone(Uint64 fence)
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    return completed >= fence;
+  }
+
+  /// The fence of the last posted task
+  Uint64 getLastFence()
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    return posted;
+  }
+
+private:
+  void loop();
+};
+
+inline RenderThread::~RenderThread()
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+template<class FUNC>
+inline Uint64
+RenderThread::post(FUNC func)
+{
+  static_assert(sizeof(FUNC) <= TASK_SIZE, "The task is too big");
+  static_assert(alignof(FUNC) <= alignof(std::max_align_t),
+                "The task alignment is too big");
+  static_assert(std::is_trivially_destructible_v<FUNC>,
+                "The task must be trivially destructible");
+  SDL_assert(std::this_thread::get_id() != thread.get_id());
+  Uint64 fence;
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    done.wait(lock, [this] { return posted - completed < QUEUE_SIZE; });
+    // The thread only reads the slot of completed, that is not this one
+    auto& task = tasks[posted % QUEUE_SIZE];
+    new (task.data) FUNC(std::move(func));
+    task.call = [](void* data) {
+      (*std::launder(static_cast<FUNC*>(data)))();
+    };
+    fence = ++posted;
+  }
+  wake.notify_one();
+  return fence;
+}
+
+inline void
+RenderThread::wait(Uint64 fence)
+{
+  std::unique_lock<std::mutex> lock{mutex};
+  SDL_assert(fence <= posted);
+  if (std::this_thread::get_id() == thread.get_id()) {
+    // It would wait forever
+    SDL_assert(fence <= completed);
+    return;
+  }
+  done.wait(lock, [&] { return completed >= fence; });
+}
+
+inline void
+RenderThread::loop()
+{
+  for (;;) {
+    Task* task;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      wake.wait(lock, [this] { return stopping || posted != completed; });
+      if (posted == completed) {
+        return;
+      }
+      task = &tasks[completed % QUEUE_SIZE];
+    }
+    task->call(task->data);
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      ++completed;
+    }
+    done.notify_all();
+  }
+}
+
+} // namespace dui
+
+#endif // DUI_RENDER_THREAD_HPP_
@@ -17,7 +17,7 @@ class Scrollable : public Targetable<Scrollable>
 public:
   /// Ctor
   Scrollable(Target parent,
-             std::string_view id,
+             Id id,
              SDL_Point* scrollOffset,
              const SDL_Rect& r,
              const ScrollableStyle& style)
@@ -127,7 +127,7 @@ makeScrollableRect(const SDL_Rect& r, Target target)
  */
 inline Scrollable
 scrollable(Target target,
-           std::string_view id,
+           Id id,
            SDL_Point* scrollOffset,
            const SDL_Rect& r = {0},
            const ScrollableStyle& style = themeFor<Scrollable>())
@@ -138,7 +138,7 @@ scrollable(Target target,
 /// @ingroup groups
 inline Scrollable
 scrollable(Target target,
-           std::string_view id,
+           Id id,
            SDL_Point* scrollOffset,
            const SDL_Rect& r,
            Layout layout = Layout::VERTICAL,
@@ -164,7 +164,7 @@ scrollable(Target target,
  */
 inline PanelImpl<Scrollable>
 scrollablePanel(Target target,
-                std::string_view id,
+                Id id,
                 SDL_Point* scrollOffset,
                 const SDL_Rect& r = {0},
                 const ScrollablePanelStyle& style = themeFor<ScrollablePanel>())
@@ -181,7 +181,7 @@ scrollablePanel(Target target,
 /// @ingroup groups
 inline PanelImpl<Scrollable>
 scrollablePanel(Target target,
-                std::string_view id,
+                Id id,
                 SDL_Point* scrollOffset,
                 const SDL_Rect& r,
                 Layout layout,
@@ -14,12 +14,12 @@ namespace dui {
 /// Returns delta
 inline std::optional<SDL_Point>
 sliderBoxBarCaret(Target target,
-                  std::string_view id,
+                  Id id,
                   const SDL_Rect& r,
                   const BoxStyle& style = themeFor<Box>())
 {
   box(target, r, style);
-  static SDL_Point mouseOffset;
+  auto& mouseOffset = target.getCached<SDL_Point>(id);
   auto action = target.checkMouse(id, r);
   if (action == MouseAction::HOLD) {
     return {{0, 0}};
@@ -53,7 +53,7 @@ enum Orientation : bool
 /// The draggable bar part of a slider box
 inline bool
 sliderBoxBar(Target target,
-             std::string_view id,
+             Id id,
              int* value,
              int min,
              int max,
@@ -126,7 +126,7 @@ sliderBoxBar(Target target,
 /// @ingroup elements
 inline bool
 sliderBox(Target target,
-          std::string_view id,
+          Id id,
           int* value,
           int min,
           int max,
@@ -179,7 +179,7 @@ sliderBox(Target target,
 /// @ingroup elements
 inline bool
 sliderBoxV(Target target,
-           std::string_view id,
+           Id id,
            int* value,
            int min,
            int max,
@@ -29,7 +29,7 @@ namespace dui {
  */
 inline bool
 sliderField(Target target,
-            std::string_view id,
+            Id id,
             std::string_view labelText,
             int* value,
             int min,
@@ -0,0 +1,569 @@
+#ifndef DUI_SOFTWARE_RENDERER_HPP_
+#define DUI_SOFTWARE_RENDERER_HPP_
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <SDL.h>
+#include "DisplayList.hpp"
+#include "ThreadPool.hpp"
+
+#if !defined(DUI_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define DUI_SIMD_AVX2
+#endif
+
+namespace dui {
+
+/**
+ * @brief Renders a DisplayList into an ARGB8888 pixel buffer on the CPU
+ *
+ * It needs no window nor SDL_Renderer, so it can be used on headless
+ * machines, for screenshots and automated checks. The blending follows the
+ * integer formulas of SDL's software renderer, so the pixels match the ones
+ * it produces.
+ *
+ * The display list refers to textures by their SDL_Texture pointer, so the
+ * pixels behind each one must be given with registerTexture() first. Shapes
+ * with unregistered textures are skipped.
+ */
+class SoftwareRenderer
+{
+  struct Image
+  {
+    std::vector<Uint32> pixels;
+    int w, h;
+    bool blend; ///< If false the pixels are copied, ignoring alpha
+  };
+  std::unordered_map<SDL_Texture*, Image> images;
+
+  /// Scratch for scaled rows, kept to avoid reallocating every shape
+  mutable std::vector<Uint32> row;
+
+  /// The shapes overlapping each tile, kept between calls
+  struct Bins
+  {
+    std::vector<Shape> shapes;
+    std::vector<SDL_Rect> clips; ///< Effective clip of each shape
+    std::vector<std::vector<Uint32>> tiles;
+    std::vector<std::vector<Uint32>> scratch; ///< Rows for each thread
+  };
+  mutable Bins bins;
+
+public:
+  /// The size of the square tiles, on the multi-threaded render()
+  static constexpr int TILE_SIZE = 64;
+
+  /// An ARGB8888 buffer to render into
+  struct PixelBuffer
+  {
+    Uint32* pixels;
+    int w, h;
+    int pitch; ///< Bytes between rows
+  };
+
+  /**
+   * @brief Register the pixels behind a texture
+   *
+   * The surface is converted to ARGB8888, turning any color key into alpha,
+   * like SDL_CreateTextureFromSurface() does. If it has alpha or a color key
+   * it is blended, otherwise copied.
+   *
+   * @param texture the texture as referenced by the display list
+   * @param surface its contents
+   * @return true on success
+   */
+  bool registerTexture(SDL_Texture* texture, SDL_Surface* surface);
+
+  /**
+   * @brief Register the pixels behind a texture
+   *
+   * @param texture the texture as referenced by the display list
+   * @param pixels its contents in ARGB8888, copied
+   * @param w the width
+   * @param h the height
+   * @param pitch bytes between rows
+   * @param blend if true it is alpha blended, otherwise copied
+   */
+  void registerTexture(SDL_Texture* texture,
+                       const Uint32* pixels,
+                       int w,
+                       int h,
+                       int pitch,
+                       bool blend = true);
+
+  /// Forget the texture
+  void unregisterTexture(SDL_Texture* texture) { images.erase(texture); }
+
+  /**
+   * @brief Render the list into target
+   *
+   * @param list the display list
+   * @param target the buffer to render into
+   * @param clip if not null, only render what is inside this rect
+   */
+  void render(const DisplayList& list,
+              const PixelBuffer& target,
+              const SDL_Rect* clip = nullptr) const;
+
+  /**
+   * @brief Render the list into target, using many threads
+   *
+   * The shapes are binned into square tiles of TILE_SIZE in a first pass,
+   * then the tiles are rendered in parallel by the pool. Each tile keeps the
+   * order of the shapes inside it and no two threads write the same pixels,
+   * so the result is the same as the single threaded render().
+   *
+   * @param list the display list
+   * @param target the buffer to render into
+   * @param pool the threads to use
+   * @param clip if not null, only render what is inside this rect
+   */
+  void render(const DisplayList& list,
+              const PixelBuffer& target,
+              ThreadPool& pool,
+              const SDL_Rect* clip = nullptr) const;
+
+  /**
+   * @brief Render the list into a surface
+   *
+   * @param list the display list
+   * @param surface a ARGB8888 surface
+   * @param clip if not null, only render what is inside this rect
+   * @return true on success
+   */
+  bool render(const DisplayList& list,
+              SDL_Surface* surface,
+              const SDL_Rect* clip = nullptr) const;
+
+  /**
+   * @brief Render a single shape into target, within clip
+   *
+   * @param shape the shape
+   * @param target the buffer to render into
+   * @param clip where it can be rendered, already inside the target
+   * @param scratch buffer for scaled rows
+   */
+  void renderShape(const Shape& shape,
+                   const PixelBuffer& target,
+                   const SDL_Rect& clip,
+                   std::vector<Uint32>& scratch) const;
+
+  /// Blend n pixels of color into dst
+  static void fillSpan(Uint32* dst, int n, SDL_Color color);
+
+  /// Blend n pixels of src, modulated by color, into dst
+  static void blendSpan(Uint32* dst, const Uint32* src, int n, SDL_Color color);
+
+  /// Copy n pixels of src, modulated by color, into dst
+  static void copySpan(Uint32* dst, const Uint32* src, int n, SDL_Color color);
+};
+
+namespace detail {
+
+/// x / 255, exact for any 16 bit x
+constexpr Uint32
+div255(Uint32 x)
+{
+  return (x * 0x8081) >> 23;
+}
+
+constexpr Uint32
+modulatePixel(Uint32 s, SDL_Color c)
+{
+  return (s & 0xff000000) | div255(((s >> 16) & 0xff) * c.r) << 16 |
+         div255(((s >> 8) & 0xff) * c.g) << 8 | div255((s & 0xff) * c.b);
+}
+
+/// Blend s into d, like SDL_BLENDMODE_BLEND
+constexpr Uint32
+blendPixel(Uint32 s, Uint32 d)
+{
+  Uint32 a = s >> 24;
+  Uint32 inv = 255 - a;
+  Uint32 r = div255(((s >> 16) & 0xff) * a) + div255(((d >> 16) & 0xff) * inv);
+  Uint32 g = div255(((s >> 8) & 0xff) * a) + div255(((d >> 8) & 0xff) * inv);
+  Uint32 b = div255((s & 0xff) * a) + div255((d & 0xff) * inv);
+  Uint32 alpha = a + div255((d >> 24) * inv);
+  return alpha << 24 | r << 16 | g << 8 | b;
+}
+
+#if defined(DUI_SIMD_SSE2)
+inline __m128i
+div255(__m128i x)
+{
+  return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16(short(0x8081))), 7);
+}
+
+/// Each channel of 2 pixels times the same channel of mod, over 255
+inline __m128i
+modulate(__m128i s, __m128i mod)
+{
+  return div255(_mm_mullo_epi16(s, mod));
+}
+
+/// Blend 2 pixels, with 16 bits per channel
+inline __m128i
+blend(__m128i s, __m128i d)
+{
+  const __m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i rgbMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+  // Alpha itself is not premultiplied
+  s = modulate(s, _mm_or_si128(_mm_and_si128(a, rgbMask), alphaLane));
+  __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return _mm_add_epi16(s, modulate(d, inv));
+}
+#endif
+
+#if defined(DUI_SIMD_AVX2)
+inline __m256i
+div255(__m256i x)
+{
+  return _mm256_srli_epi16(
+    _mm256_mulhi_epu16(x, _mm256_set1_epi16(short(0x8081))), 7);
+}
+
+inline __m256i
+modulate(__m256i s, __m256i mod)
+{
+  return div255(_mm256_mullo_epi16(s, mod));
+}
+
+/// Blend 4 pixels, with 16 bits per channel
+inline __m256i
+blend(__m256i s, __m256i d)
+{
+  const __m256i alphaLane = _mm256_set_epi16(
+    255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+  const __m256i rgbMask = _mm256_set_epi16(
+    0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+  __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+  s = modulate(s, _mm256_or_si256(_mm256_and_si256(a, rgbMask), alphaLane));
+  __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+  return _mm256_add_epi16(s, modulate(d, inv));
+}
+#endif
+} // namespace detail
+
+inline bool
+SoftwareRenderer::registerTexture(SDL_Texture* texture, SDL_Surface* surface)
+{
+  SDL_Surface* converted =
+    SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (!converted) {
+    return false;
+  }
+  Uint32 key;
+  bool blend = SDL_ISPIXELFORMAT_ALPHA(surface->format->format) ||
+               SDL_GetColorKey(surface, &key) == 0;
+  SDL_LockSurface(converted);
+  registerTexture(texture,
+                  static_cast<const Uint32*>(converted->pixels),
+                  converted->w,
+                  converted->h,
+                  converted->pitch,
+                  blend);
+  SDL_UnlockSurface(converted);
+  SDL_FreeSurface(converted);
+  return true;
+}
+
+inline void
+SoftwareRenderer::registerTexture(SDL_Texture* texture,
+                                  const Uint32* pixels,
+                                  int w,
+                                  int h,
+                                  int pitch,
+                                  bool blend)
+{
+  auto& image = images[texture];
+  image.w = w;
+  image.h = h;
+  image.blend = blend;
+  image.pixels.resize(size_t(w) * h);
+  auto bytes = static_cast<const Uint8*>(static_cast<const void*>(pixels));
+  for (int y = 0; y < h; ++y) {
+    SDL_memcpy(&image.pixels[size_t(y) * w],
+               bytes + size_t(y) * pitch,
+               size_t(w) * sizeof(Uint32));
+  }
+}
+
+inline void
+SoftwareRenderer::render(const DisplayList& list,
+                         const PixelBuffer& target,
+                         const SDL_Rect* clip) const
+{
+  SDL_Rect bounds{0, 0, target.w, target.h};
+  list.visit(
+    [&](const Shape& shape, const SDL_Rect* shapeClip) {
+      SDL_Rect rect;
+      if (shapeClip) {
+        if (!SDL_IntersectRect(shapeClip, &bounds, &rect)) {
+          return;
+        }
+      } else {
+        rect = bounds;
+      }
+      renderShape(shape, target, rect, row);
+    },
+    clip);
+}
+
+inline void
+SoftwareRenderer::render(const DisplayList& list,
+                         const PixelBuffer& target,
+                         ThreadPool& pool,
+                         const SDL_Rect* clip) const
+{
+  SDL_Rect bounds{0, 0, target.w, target.h};
+  int cols = (target.w + TILE_SIZE - 1) / TILE_SIZE;
+  int rows = (target.h + TILE_SIZE - 1) / TILE_SIZE;
+  bins.tiles.resize(size_t(cols) * rows);
+  for (auto& tile : bins.tiles) {
+    tile.clear();
+  }
+  bins.shapes.clear();
+  bins.clips.clear();
+  list.visit(
+    [&](const Shape& shape, const SDL_Rect* shapeClip) {
+      SDL_Rect rect = bounds;
+      if (shapeClip && !SDL_IntersectRect(shapeClip, &bounds, &rect)) {
+        return;
+      }
+      SDL_Rect visible;
+      if (!SDL_IntersectRect(&shape.rect, &rect, &visible)) {
+        return;
+      }
+      auto index = Uint32(bins.shapes.size());
+      bins.shapes.push_back(shape);
+      bins.clips.push_back(rect);
+      int lastY = (visible.y + visible.h - 1) / TILE_SIZE;
+      int lastX = (visible.x + visible.w - 1) / TILE_SIZE;
+      for (int y = visible.y / TILE_SIZE; y <= lastY; ++y) {
+        for (int x = visible.x / TILE_SIZE; x <= lastX; ++x) {
+          bins.tiles[size_t(y) * cols + x].push_back(index);
+        }
+      }
+    },
+    clip);
+
+  bins.scratch.resize(pool.size());
+  pool.run(bins.tiles.size(), [&](size_t tile, size_t thread) {
+    auto& indices = bins.tiles[tile];
+    if (indices.empty()) {
+      return;
+    }
+    SDL_Rect tileRect{int(tile % cols) * TILE_SIZE,
+                      int(tile / cols) * TILE_SIZE,
+                      TILE_SIZE,
+                      TILE_SIZE};
+    SDL_IntersectRect(&tileRect, &bounds, &tileRect);
+    for (auto index : indices) {
+      SDL_Rect rect;
+      if (SDL_IntersectRect(&bins.clips[index], &tileRect, &rect)) {
+        renderShape(bins.shapes[index], target, rect, bins.scratch[thread]);
+      }
+    }
+  });
+}
+
+inline bool
+SoftwareRenderer::render(const DisplayList& list,
+                         SDL_Surface* surface,
+                         const SDL_Rect* clip) const
+{
+  if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+    SDL_SetError("Surface must be ARGB8888");
+    return false;
+  }
+  if (SDL_LockSurface(surface) < 0) {
+    return false;
+  }
+  render(list,
+         {static_cast<Uint32*>(surface->pixels),
+          surface->w,
+          surface->h,
+          surface->pitch},
+         clip);
+  SDL_UnlockSurface(surface);
+  return true;
+}
+
+inline void
+SoftwareRenderer::renderShape(const Shape& shape,
+                              const PixelBuffer& target,
+                              const SDL_Rect& clip,
+                              std::vector<Uint32>& scratch) const
+{
+  SDL_Rect rect;
+  if (!SDL_IntersectRect(&shape.rect, &clip, &rect)) {
+    return;
+  }
+  auto rowAt = [&](int y) {
+    auto bytes = static_cast<Uint8*>(static_cast<void*>(target.pixels));
+    return reinterpret_cast<Uint32*>(bytes + size_t(y) * target.pitch) +
+           rect.x;
+  };
+  if (shape.texture == nullptr) {
+    for (int y = rect.y; y < rect.y + rect.h; ++y) {
+      fillSpan(rowAt(y), rect.w, shape.color);
+    }
+    return;
+  }
+  auto it = images.find(shape.texture);
+  if (it == images.end()) {
+    return;
+  }
+  auto& image = it->second;
+  SDL_Rect src = shape.srcRect;
+  if (src.w == 0) {
+    src = {0, 0, image.w, image.h};
+  }
+  auto& dst = shape.rect;
+  if (src.x < 0 || src.y < 0 || src.x + src.w > image.w ||
+      src.y + src.h > image.h || src.w <= 0 || src.h <= 0) {
+    return;
+  }
+
+  // Same 16.16 fixed point stepping used by SDL's scaled blits
+  Uint32 incX = (Uint32(src.w) << 16) / dst.w;
+  Uint32 incY = (Uint32(src.h) << 16) / dst.h;
+  bool scaledX = src.w != dst.w;
+  if (scaledX) {
+    scratch.resize(rect.w);
+  }
+  for (int y = rect.y; y < rect.y + rect.h; ++y) {
+    int srcY = src.y + int((Uint32(y - dst.y) * incY + incY / 2) >> 16);
+    const Uint32* srcRow = &image.pixels[size_t(srcY) * image.w];
+    const Uint32* span;
+    if (scaledX) {
+      Uint32 posX = Uint32(rect.x - dst.x) * incX + incX / 2;
+      for (int x = 0; x < rect.w; ++x, posX += incX) {
+        scratch[x] = srcRow[src.x + int(posX >> 16)];
+      }
+      span = scratch.data();
+    } else {
+      span = srcRow + src.x + (rect.x - dst.x);
+    }
+    if (image.blend) {
+      blendSpan(rowAt(y), span, rect.w, shape.color);
+    } else {
+      copySpan(rowAt(y), span, rect.w, shape.color);
+    }
+  }
+}
+
+inline void
+SoftwareRenderer::fillSpan(Uint32* dst, int n, SDL_Color c)
+{
+  Uint32 pixel = Uint32(c.a) << 24 | Uint32(c.r) << 16 | Uint32(c.g) << 8 | c.b;
+  if (c.a == 255) {
+    std::fill_n(dst, n, pixel);
+    return;
+  }
+  int i = 0;
+#if defined(DUI_SIMD_AVX2)
+  __m256i s256 =
+    _mm256_unpacklo_epi8(_mm256_set1_epi32(int(pixel)), _mm256_setzero_si256());
+  for (; i + 8 <= n; i += 8) {
+    auto p = reinterpret_cast<__m256i*>(dst + i);
+    __m256i d = _mm256_loadu_si256(p);
+    __m256i lo = detail::blend(
+      s256, _mm256_unpacklo_epi8(d, _mm256_setzero_si256()));
+    __m256i hi = detail::blend(
+      s256, _mm256_unpackhi_epi8(d, _mm256_setzero_si256()));
+    _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+  }
+#endif
+#if defined(DUI_SIMD_SSE2)
+  __m128i s128 =
+    _mm_unpacklo_epi8(_mm_set1_epi32(int(pixel)), _mm_setzero_si128());
+  for (; i + 4 <= n; i += 4) {
+    auto p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i d = _mm_loadu_si128(p);
+    __m128i lo =
+      detail::blend(s128, _mm_unpacklo_epi8(d, _mm_setzero_si128()));
+    __m128i hi =
+      detail::blend(s128, _mm_unpackhi_epi8(d, _mm_setzero_si128()));
+    _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] = detail::blendPixel(pixel, dst[i]);
+  }
+}
+
+inline void
+SoftwareRenderer::blendSpan(Uint32* dst,
+                            const Uint32* src,
+                            int n,
+                            SDL_Color c)
+{
+  int i = 0;
+#if defined(DUI_SIMD_AVX2)
+  __m256i mod256 = _mm256_set_epi16(255, c.r, c.g, c.b, 255, c.r, c.g, c.b,
+                                    255, c.r, c.g, c.b, 255, c.r, c.g, c.b);
+  for (; i + 8 <= n; i += 8) {
+    auto zero = _mm256_setzero_si256();
+    auto p = reinterpret_cast<__m256i*>(dst + i);
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i d = _mm256_loadu_si256(p);
+    __m256i lo =
+      detail::blend(detail::modulate(_mm256_unpacklo_epi8(s, zero), mod256),
+                    _mm256_unpacklo_epi8(d, zero));
+    __m256i hi =
+      detail::blend(detail::modulate(_mm256_unpackhi_epi8(s, zero), mod256),
+                    _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+  }
+#endif
+#if defined(DUI_SIMD_SSE2)
+  __m128i mod128 = _mm_set_epi16(255, c.r, c.g, c.b, 255, c.r, c.g, c.b);
+  for (; i + 4 <= n; i += 4) {
+    auto zero = _mm_setzero_si128();
+    auto p = reinterpret_cast<__m128i*>(dst + i);
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i d = _mm_loadu_si128(p);
+    __m128i lo =
+      detail::blend(detail::modulate(_mm_unpacklo_epi8(s, zero), mod128),
+                    _mm_unpacklo_epi8(d, zero));
+    __m128i hi =
+      detail::blend(detail::modulate(_mm_unpackhi_epi8(s, zero), mod128),
+                    _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] = detail::blendPixel(detail::modulatePixel(src[i], c), dst[i]);
+  }
+}
+
+inline void
+SoftwareRenderer::copySpan(Uint32* dst, const Uint32* src, int n, SDL_Color c)
+{
+  if (c.r == 255 && c.g == 255 && c.b == 255) {
+    std::copy_n(src, n, dst);
+    return;
+  }
+  int i = 0;
+#if defined(DUI_SIMD_SSE2)
+  __m128i mod128 = _mm_set_epi16(255, c.r, c.g, c.b, 255, c.r, c.g, c.b);
+  for (; i + 4 <= n; i += 4) {
+    auto zero = _mm_setzero_si128();
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = detail::modulate(_mm_unpacklo_epi8(s, zero), mod128);
+    __m128i hi = detail::modulate(_mm_unpackhi_epi8(s, zero), mod128);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] = detail::modulatePixel(src[i], c);
+  }
+}
+
+} // namespace dui
+
+#endif // DUI_SOFTWARE_RENDERER_HPP_
@@ -1,14 +1,27 @@
 #ifndef DUI_STATE_HPP_
 #define DUI_STATE_HPP_
 
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 #include <SDL.h>
 #include "DisplayList.hpp"
+#include "ElementCache.hpp"
 #include "Font.hpp"
+#include "FrameArena.hpp"
+#include "HitIndex.hpp"
+#include "InputQueue.hpp"
+#include "Id.hpp"
+#include "LayerCache.hpp"
+#include "RenderThread.hpp"
+#include "TextureAtlas.hpp"
 
-namespace dui {
+#ifdef DUI_DEBUG_IDS
+#include <unordered_map>
+#endif
 
-constexpr char groupNameSeparator = '/';
+namespace dui {
 
 /**
  * @brief The mouse action and status for a element in a frame
@@ -35,46 +48,152 @@ enum class TextAction
   KEYDOWN, ///< erased last character
 };
 
+/// A text input or key down, see State.textEvents()
+struct TextEvent
+{
+  TextAction action;                       ///< INPUT or KEYDOWN
+  SDL_Keysym keysym;                       ///< The key, if KEYDOWN
+  char text[SDL_TEXTINPUTEVENT_TEXT_SIZE]; ///< The text, if INPUT
+};
+
+/// A range of TextEvent
+struct TextEvents
+{
+  const TextEvent* first = nullptr;
+  const TextEvent* last = nullptr;
+
+  const TextEvent* begin() const { return first; }
+  const TextEvent* end() const { return last; }
+  bool empty() const { return first == last; }
+};
+
 /**
  * @brief Stores the ui state
  *
  * This should be the only state that needs to be preserved between the program
  * loops.
  *
+ * Elements keep nothing outside of their State, so different States can be
+ * used at the same time on different threads, as long as each is used by one
+ * thread at a time. Building a frame only touches the State, but the
+ * constructor, render() and renderDamaged() use the SDL_Renderer, so they must
+ * run on the thread it belongs to. SDL_Init() must have been called before, as
+ * frames read SDL_GetTicks().
  */
 class State
 {
   bool inFrame = false;
   SDL_Renderer* renderer;
-  DisplayList dList;
+  // Two buffers, so one frame can be rendered while the next is built
+  FrameArena arenas[2];
+  DisplayList lists[2]{DisplayList{&arenas[0]}, DisplayList{&arenas[1]}};
+  Uint64 fences[2] = {0, 0}; ///< When each buffer was last rendered
+  RenderThread* renderThread = nullptr;
+  int current = 0; ///< The buffer of the current or last frame
+  FrameArena* arena = &arenas[0];
+  DisplayList* dList = &lists[0];
 
-  SDL_Point mPos;
+  InputQueue input; ///< The events for the next frames
+  SDL_Point mPos{-1, -1};
+  SDL_Point mNextPos{-1, -1}; ///< mPos after the queued events
   bool mLeftPressed = false;
-  std::string eGrabbed;
-  bool mHovering = false;
+  Uint64 eGrabbed = 0; ///< The grabbed element id or 0
+  Uint64 eHovered = 0; ///< The topmost element at mPos on the last frame or 0
   bool mGrabbing = false;
   bool mReleasing = false;
-  std::string eActive;
-  char tBuffer[SDL_TEXTINPUTEVENT_TEXT_SIZE];
-  SDL_Keysym tKeysym;
-  bool tChanged = false;
-  TextAction tAction = TextAction::NONE;
+  Uint64 eActive = 0; ///< The active element id or 0
+  TextEvent tEvents[InputQueue::CAPACITY]; ///< The text events of this frame
+  size_t tCount = 0;
+  bool tookInput = false; ///< If the frame took any queued event
+
+  Uint64 groupId = ROOT_ID;
+  std::vector<Uint64> idStack; ///< The ids of the enclosing groups
+  std::vector<SDL_Rect> clips; ///< The clip rects of the enclosing groups
+
+  HitIndex hitIndex; ///< The elements of the last frame
+
+  /// The display lists of a layer, one per buffer
+  struct LayerLists
+  {
+    DisplayList lists[2]{DisplayList{}, DisplayList{}};
+  };
+  struct OpenLayer
+  {
+    DisplayList* parent; ///< Where it is inserted when it ends
+    Uint64 key;
+  };
+  std::vector<OpenLayer> layerStack;
+  LayerCache layerCache;
+
+  /// What a memo added on the frame it was last built
+  struct MemoRecord
+  {
+    DisplayList list{};
+    HitIndex hits;
+    Uint64 key = 0; ///< Of its dependencies and placement, 0 if never built
+    SDL_Point size{0, 0};
+    bool mouseInside = false; ///< If it was built with the mouse over it
+    std::vector<Uint64> cacheKeys; ///< The cached values its elements use
+  };
+  struct OpenMemo
+  {
+    DisplayList* parent; ///< Where it is appended when it ends
+    MemoRecord* record;
+    size_t firstHit; ///< The hits pending when it began
+    size_t firstKey; ///< Where its cache keys begin
+    Uint64 key;
+    SDL_Point pos;
+  };
+  std::vector<OpenMemo> memoStack;
 
-  std::string group;
-  bool gGrabbed = false;
-  bool gActive = false;
+#ifdef DUI_DEBUG_IDS
+  std::string groupPath;
+  std::vector<size_t> groupPathSizes;
+  /// The path of each id seen this frame, to detect collisions
+  mutable std::unordered_map<Uint64, std::string> idPaths;
+#endif
 
   Uint32 ticksCount;
+  Uint32 wakeup = 0; ///< When the next frame is needed, or 0 if none
 
+  ElementCache cache;
+
+  // The grabbed and active ids when this subtree began, see Subtrees
+  Uint64 baseGrabbed = 0;
+  Uint64 baseActive = 0;
+
+  Uint64 renderedFingerprint = 0;
+  bool invalidated = true;
+
+  SDL_Texture* canvas = nullptr;
+  SDL_Color canvasBackground;
+
+  TextureAtlas atlas;
+  bool deviceReset = false; ///< If the renderer lost its textures
+  Uint32 textureResets = 0;  ///< How many times they were created again
   Font font;
 
 public:
   /// Ctor
   State(SDL_Renderer* renderer)
     : renderer(renderer)
-    , font(loadDefaultFont(renderer))
+    , atlas(renderer)
+    , font(loadDefaultFont(atlas, renderer))
   {}
 
+  State(const State&) = delete;
+  State& operator=(const State&) = delete;
+
+  ~State()
+  {
+    if (renderThread) {
+      renderThread->wait(std::max(fences[0], fences[1]));
+    }
+    if (canvas) {
+      SDL_DestroyTexture(canvas);
+    }
+  }
+
   /**
    * @brief Render the ui
    *
@@ -85,12 +204,154 @@ public:
   void render()
   {
     SDL_assert(!inFrame);
-    dList.render(renderer);
+    if (invalidated) {
+      layerCache.invalidate();
+    }
+    layerCache.prepare(renderer, *dList);
+    dList->render(renderer);
+    renderedFingerprint = dList->getFingerprint();
+    invalidated = false;
+  }
+
+  /**
+   * @brief Render the ui, redrawing only the areas that changed
+   *
+   * The ui is kept on a persistent canvas texture, where only the damaged
+   * areas, where something was added, removed, moved or recolored since the
+   * last call, are cleared with background and rendered again. Then the whole
+   * canvas is copied to the current render target, so you don't need to clear
+   * it before.
+   *
+   * If the renderer does not support render targets, this clears the screen
+   * with background and calls render().
+   *
+   * This must not be in frame.
+   *
+   * @param background the color behind the ui
+   */
+  void renderDamaged(SDL_Color background);
+
+  /**
+   * @brief Render the ui on a RenderThread, and present it
+   *
+   * The last finished frame is cleared with background, rendered and presented
+   * on thread, while this returns immediately, so you can build the next frame
+   * meanwhile. Beginning the frame after the next one waits for this to finish,
+   * as it reuses its buffer.
+   *
+   * If the frame is not dirty nothing is submitted.
+   *
+   * Once you use this, the renderer must only be used on thread, and all
+   * textures used by the ui must stay valid until the frame using them
+   * finishes rendering (see RenderThread). Don't mix it with render() or
+   * renderDamaged().
+   *
+   * This must not be in frame.
+   *
+   * @param thread the render thread, that must outlive this
+   * @param background the color to clear the screen with
+   * @return the fence of the frame, or of the last submitted one if nothing
+   * changed. Wait for it on thread to be sure the frame is on the screen.
+   */
+  Uint64 submit(RenderThread& thread, SDL_Color background);
+
+  /**
+   * @brief If the last finished frame differs from the last rendered one
+   *
+   * When this is false, calling render() would draw exactly the same as before,
+   * so you can skip clearing, rendering and presenting altogether.
+   *
+   * This must not be in frame.
+   */
+  bool isDirty() const
+  {
+    SDL_assert(!inFrame);
+    return invalidated || dList->getFingerprint() != renderedFingerprint;
+  }
+
+  /**
+   * @brief Force the next frame to be considered dirty
+   *
+   * Use this when something not tracked by the display list changed, like the
+   * contents of a texture used by textureBox(). Window and render target reset
+   * events already do this on event().
+   */
+  void invalidate() { invalidated = true; }
+
+  /**
+   * @brief If the ui is waiting for nothing but new events
+   *
+   * That is when the last frame took no input and no more is queued. Then a
+   * new frame would be the same as the last one until the next event or
+   * getNextWakeup(), so you can sleep until then (see waitEvent()). A grabbed
+   * element doesn't keep it unsettled, as dragging it sends motion events.
+   */
+  bool isSettled() const { return !inFrame && !tookInput && input.empty(); }
+
+  /**
+   * @brief When an element of the last frame needs a new one, in ticks
+   *
+   * Like a text box, to blink the cursor.
+   *
+   * @return the ticks or 0 if none
+   */
+  Uint32 getNextWakeup() const { return wakeup; }
+
+  /**
+   * @brief Ask for a new frame at ticks
+   *
+   * Call this on time based elements, when they change next. It is kept until
+   * the next frame begins.
+   *
+   * @param ticks the SDL_GetTicks() value
+   */
+  void wakeAt(Uint32 ticks)
+  {
+    if (ticks == 0) {
+      ticks = 1; // 0 means none
+    }
+    if (wakeup == 0 || Sint32(ticks - wakeup) < 0) {
+      wakeup = ticks;
+    }
   }
 
+  /**
+   * @brief How long to wait for events before a new frame is needed
+   *
+   * @return 0 if not isSettled(), the milliseconds to getNextWakeup() or -1 if
+   * it can wait forever
+   */
+  int getWaitTimeout() const;
+
+  /**
+   * @brief Wait for an event, until a new frame is needed
+   *
+   * It calls SDL_WaitEvent(), SDL_WaitEventTimeout() or SDL_PollEvent(),
+   * according to getWaitTimeout(). Use it instead of SDL_PollEvent() for the
+   * first event of the frame, so the app sleeps while idle:
+   *
+   * ```cpp
+   * SDL_Event ev;
+   * for (bool got = state.waitEvent(&ev); got; got = SDL_PollEvent(&ev)) {
+   *   state.event(ev);
+   * }
+   * ```
+   *
+   * Like those, it must be called on the thread that set up the video mode.
+   *
+   * @param ev where the event is stored
+   * @return true if there was an event
+   */
+  bool waitEvent(SDL_Event* ev) const;
+
   /**
    * @brief Handle a SDL_Event
    *
+   * The input events are queued, and each frame takes them in order up to the
+   * next left mouse button press or release, that is left for the next frame if
+   * there was text before. So a quick click or typing is never lost, even at
+   * low frame rates.
+   *
    * @param ev event
    */
   void event(SDL_Event& ev);
@@ -117,10 +378,7 @@ public:
    * @return true
    * @return false
    */
-  bool isActive(std::string_view id) const
-  {
-    return isSameGroupId(eActive, id);
-  }
+  bool isActive(Id id) const { return eActive == elementId(id); }
 
   /**
    * @brief Check the mouse action/status for element in this frame
@@ -129,41 +387,76 @@ public:
    * @param r the element global rect (Use Group.checkMouse() for local rect)
    * @return MouseAction
    */
-  MouseAction checkMouse(std::string_view id, SDL_Rect r);
+  MouseAction checkMouse(Id id, SDL_Rect r);
+
+  /**
+   * @brief The text events for the element in this frame
+   *
+   * It is empty unless the element is active. An element taking text should
+   * handle all of them, in order.
+   *
+   * @param id the element id
+   */
+  TextEvents textEvents(Id id) const
+  {
+    if (tCount == 0 || eActive != elementId(id)) {
+      return {};
+    }
+    return {tEvents, tEvents + tCount};
+  }
 
   /**
    * @brief Check the text action/status for element in this frame
    *
+   * This only sees the last text event, the one lastText() or lastKeyDown()
+   * return, use textEvents() to get all.
+   *
    * @param id the element id
    * @return TextAction
    */
-  TextAction checkText(std::string_view id) const
+  TextAction checkText(Id id) const
   {
-    if (!tChanged || !isSameGroupId(eActive, id)) {
+    if (tCount == 0 || eActive != elementId(id)) {
       return TextAction::NONE;
     }
-    return tAction;
+    return tEvents[tCount - 1].action;
   }
 
   /**
-   * @brief Get the last input text
+   * @brief Get the last input text of this frame
    *
    * To check if the text was for the current element and frame, use checkText()
-   * or Group.checkText().
+   * or Group.checkText(). Use textEvents() to get all of them.
    *
    * @return std::string_view
    */
-  std::string_view lastText() const { return {tBuffer}; }
+  std::string_view lastText() const
+  {
+    for (size_t i = tCount; i-- > 0;) {
+      if (tEvents[i].action == TextAction::INPUT) {
+        return tEvents[i].text;
+      }
+    }
+    return "";
+  }
 
   /**
-   * @brief Get the last key
+   * @brief Get the last key down of this frame
    *
    * To check if the text was for the current element and frame, use checkText()
-   * or Group.checkText().
+   * or Group.checkText(). Use textEvents() to get all of them.
    *
    * @return SDL_Keysym
    */
-  SDL_Keysym lastKeyDown() const { return tKeysym; }
+  SDL_Keysym lastKeyDown() const
+  {
+    for (size_t i = tCount; i-- > 0;) {
+      if (tEvents[i].action == TextAction::KEYDOWN) {
+        return tEvents[i].keysym;
+      }
+    }
+    return SDL_Keysym{};
+  }
 
   /**
    * @brief Last mouse position
@@ -172,31 +465,151 @@ public:
    */
   SDL_Point lastMousePos() const { return mPos; }
 
+  /**
+   * @brief Check if the element was the topmost under the mouse
+   *
+   * This is looked up on the elements of the last frame, so an element is never
+   * hovered on the frame it first appears. Groups with an id, like windows and
+   * panels, count as elements where none of their contents is.
+   *
+   * @param id the element id
+   */
+  bool isHovered(Id id) const
+  {
+    return eHovered != 0 && eHovered == elementId(id);
+  }
+
   /**
    * @brief If true, the state wants the mouse events
+   *
+   * That is when grabbing an element or when the mouse is over one of the last
+   * frame.
    */
-  bool wantsMouse() const { return mHovering || !eGrabbed.empty(); }
+  bool wantsMouse() const
+  {
+    return eGrabbed != 0 || hitIndex.find(mNextPos) != 0;
+  }
 
   /**
    * @brief If true, the state wants the keyboard events
    * @return true
    * @return false
    */
-  bool wantsKeyboard() const { return !eActive.empty(); }
+  bool wantsKeyboard() const { return eActive != 0; }
 
   /**
    * @brief Add the given item Shape to display list
    *
    * @param item
    */
-  void display(const Shape& item) { dList.insert(item); }
+  void display(const Shape& item) { dList->insert(item); }
+
+  /**
+   * @brief Add the given text to display list
+   *
+   * @param str the text
+   * @param p the position of the first character
+   * @param font the font
+   * @param scale 0: 1x, 1: 2x, 2: 4x, 3: 8x, and so on
+   * @param color the color
+   */
+  void displayText(std::string_view str,
+                   const SDL_Point& p,
+                   const Font& font,
+                   int scale,
+                   SDL_Color color)
+  {
+    dList->insertText(str, p, font, scale, color);
+  }
+
+  /**
+   * @brief Data of type T kept for the element between frames
+   *
+   * Use it for the element's own state, like a cursor position, instead of
+   * static variables. It is value initialized the first time, and destroyed
+   * when the element is not seen for a while (see ElementCache).
+   *
+   * @param id the element id
+   */
+  template<class T>
+  T& getCached(Id id) { return cache.get<T>(elementId(id)); }
+
+  /// The cache used by getCached()
+  ElementCache& getElementCache() { return cache; }
 
   /// Ticks count
   Uint32 ticks() const { return ticksCount; }
 
+  /**
+   * @brief The display list of the last frame
+   *
+   * Use it to render by other means, like with SoftwareRenderer.
+   */
+  const DisplayList& getDisplayList() const { return *dList; }
+
+  /**
+   * @brief Memory resource for things that only need to live until the next
+   * frame begins
+   *
+   * Use it for per frame text, like formatted labels, to avoid allocations.
+   */
+  std::pmr::memory_resource* getFrameResource() { return arena; }
+
+  /// The frame arena behind getFrameResource(), for arenaNew()
+  FrameArena& getFrameArena() { return *arena; }
+
+  /**
+   * @brief The textures where the layers are kept between renders
+   *
+   * Use it to change its budget. With submit(), it is used on the render
+   * thread, so only do it there.
+   */
+  LayerCache& getLayerCache() { return layerCache; }
+
+  /**
+   * @brief The atlas holding the font, where you can add your images
+   *
+   * Display them with textureBox(). With submit(), it is used on the render
+   * thread, so only add to it there.
+   */
+  TextureAtlas& getTextureAtlas() { return atlas; }
+
   // These are experimental and should not be used
-  void beginGroup(std::string_view id, const SDL_Rect& r);
-  void endGroup(std::string_view id, const SDL_Rect& r);
+  void beginGroup(Id id, const SDL_Rect& r, bool clip = true);
+  void endGroup(Id id, const SDL_Rect& r, bool clip = true);
+
+  /**
+   * @brief Begin adding the elements to a layer, until endLayer()
+   *
+   * The layer is added as a single command, that the render methods draw from
+   * a texture kept between frames (see LayerCache), rendering it again only
+   * when its content changes. Use it for big, mostly static parts of the ui,
+   * like panels and windows with the cached style flag do.
+   *
+   * @param id the layer id, unique in the current group
+   */
+  void beginLayer(Id id);
+  /// End the layer begun by the matching beginLayer()
+  void endLayer();
+
+  /**
+   * @brief Begin a memo, or replay it if nothing changed since it was built
+   *
+   * It is replayed, adding the elements and hit rects it added on the frame it
+   * was last built, when its dependencies, position and clip rect are the
+   * same, the mouse is not over it (and was not then), nothing inside it is
+   * grabbed or active and it has no layers.
+   *
+   * @param id the memo id, unique in the current group
+   * @param pos its top left corner
+   * @param deps the hash of what its elements depend on
+   * @param[out] size its size, if replayed
+   * @return true if it must be built, calling endMemo() after, or false if
+   * it was replayed
+   */
+  bool beginMemo(Id id, const SDL_Point& pos, Uint64 deps, SDL_Point* size);
+  /// End the memo built after the matching beginMemo(), recording it
+  void endMemo(const SDL_Point& size);
   const Font& getFont() const { return font; }
   void setFont(const Font& f) { font = f; }
 
@@ -205,8 +618,36 @@ private:
   {
     SDL_assert(inFrame == false);
     inFrame = true;
-    dList.clear();
-    mHovering = false;
+    // The other buffer has the last frame, that might be rendering
+    auto last = dList;
+    current ^= 1;
+    if (renderThread && fences[current]) {
+      renderThread->wait(fences[current]);
+    }
+    if (deviceReset) {
+      // Before anything uses them, on the thread of the renderer
+      if (renderThread) {
+        renderThread->call([this] { restoreTextures(); });
+      } else {
+        restoreTextures();
+      }
+      deviceReset = false;
+    }
+    arena = &arenas[current];
+    dList = &lists[current];
+    arena->reset();
+    dList->reset();
+    dList->takePresented(*last);
+    cache.nextFrame();
+    SDL_assert(idStack.empty());
+    SDL_assert(layerStack.empty());
+    SDL_assert(memoStack.empty());
+#ifdef DUI_DEBUG_IDS
+    idPaths.clear();
+#endif
+    wakeup = 0;
+    takeInput();
+    eHovered = hitIndex.find(mPos);
     ticksCount = SDL_GetTicks();
   }
 
@@ -214,63 +655,308 @@ private:
   {
     SDL_assert(inFrame == true);
     inFrame = false;
-    tChanged = false;
+    SDL_assert(clips.empty());
+    hitIndex.build();
+    tCount = 0;
     mGrabbing = false;
     if (mReleasing) {
-      eGrabbed.clear();
+      eGrabbed = 0;
       mReleasing = false;
     }
   }
 
-  bool isSameGroupId(std::string_view qualifiedId, std::string_view id) const;
+  /// Take the queued events for this frame
+  void takeInput();
+
+  /// The id of the element named id in the current group
+  Uint64 elementId(Id id) const;
+
+  /// The part of r inside the enclosing groups
+  SDL_Rect visibleRect(const SDL_Rect& r) const
+  {
+    SDL_Rect visible = r;
+    if (!clips.empty() && !SDL_IntersectRect(&r, &clips.back(), &visible)) {
+      return {0, 0, 0, 0};
+    }
+    return visible;
+  }
+
+  /// If no other element was over this one at mPos on the last frame
+  bool isReachable(Uint64 elId) const
+  {
+    return eHovered == 0 || eHovered == elId || eHovered == groupId ||
+           std::find(idStack.begin(), idStack.end(), eHovered) !=
+             idStack.end();
+  }
+
+  struct SubtreeTag
+  {};
+
+  /// Ctor for the State of a subtree, see Subtrees
+  State(SubtreeTag, const State& parent)
+    : renderer(parent.renderer)
+    , atlas(parent.renderer)
+    , font(parent.font)
+  {}
+
+  /// The State of the subtree with the given id, kept between frames
+  State& getSubtree(Id id);
+
+  /// Begin a frame on subtree, seeing the input and group as this does
+  void beginSubtree(State& subtree) const;
+
+  /// Create the textures again after a SDL_RENDER_DEVICE_RESET
+  void restoreTextures();
+
+  /// End the frame on subtree, merging its changes and display list
+  void endSubtree(State& subtree);
 
   friend class Frame;
+  friend class Subtrees;
 };
 
+inline void
+State::renderDamaged(SDL_Color background)
+{
+  SDL_assert(!inFrame);
+  bool full = invalidated || background.r != canvasBackground.r ||
+              background.g != canvasBackground.g ||
+              background.b != canvasBackground.b ||
+              background.a != canvasBackground.a;
+  SDL_Point sz;
+  SDL_GetRendererOutputSize(renderer, &sz.x, &sz.y);
+  if (canvas) {
+    SDL_Point canvasSz;
+    SDL_QueryTexture(canvas, nullptr, nullptr, &canvasSz.x, &canvasSz.y);
+    if (canvasSz.x != sz.x || canvasSz.y != sz.y) {
+      SDL_DestroyTexture(canvas);
+      canvas = nullptr;
+    }
+  }
+  if (!canvas) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 &&
+        (info.flags & SDL_RENDERER_TARGETTEXTURE)) {
+      canvas = SDL_CreateTexture(renderer,
+                                 SDL_PIXELFORMAT_ARGB8888,
+                                 SDL_TEXTUREACCESS_TARGET,
+                                 sz.x,
+                                 sz.y);
+    }
+    if (!canvas) {
+      SDL_SetRenderDrawColor(
+        renderer, background.r, background.g, background.b, background.a);
+      SDL_RenderFillRect(renderer, nullptr);
+      render();
+      return;
+    }
+    SDL_SetTextureBlendMode(canvas, SDL_BLENDMODE_NONE);
+    full = true;
+  }
+  if (invalidated) {
+    layerCache.invalidate();
+  }
+  layerCache.prepare(renderer, *dList);
+  canvasBackground = background;
+  dList->renderDamaged(renderer, canvas, background, full);
+  renderedFingerprint = dList->getFingerprint();
+  invalidated = false;
+}
+
+inline Uint64
+State::submit(RenderThread& thread, SDL_Color background)
+{
+  SDL_assert(!inFrame);
+  SDL_assert(!renderThread || renderThread == &thread);
+  renderThread = &thread;
+  if (!isDirty()) {
+    return std::max(fences[0], fences[1]);
+  }
+  bool reset = invalidated;
+  renderedFingerprint = dList->getFingerprint();
+  invalidated = false;
+  auto list = dList;
+  auto renderer = this->renderer;
+  auto layers = &layerCache;
+  fences[current] =
+    thread.post([list, renderer, layers, background, reset] {
+      if (reset) {
+        layers->invalidate();
+      }
+      layers->prepare(renderer, *list);
+      SDL_SetRenderDrawColor(
+        renderer, background.r, background.g, background.b, background.a);
+      SDL_RenderClear(renderer);
+      list->render(renderer);
+      SDL_RenderPresent(renderer);
+    });
+  return fences[current];
+}
+
+inline int
+State::getWaitTimeout() const
+{
+  if (!isSettled()) {
+    return 0;
+  }
+  if (wakeup == 0) {
+    return -1;
+  }
+  Sint32 left = wakeup - SDL_GetTicks();
+  return left > 0 ? left : 0;
+}
+
 inline bool
-State::isSameGroupId(std::string_view qualifiedId, std::string_view id) const
+State::waitEvent(SDL_Event* ev) const
 {
-  auto groupSize = group.size();
-  if (qualifiedId.size() < groupSize + 1) {
-    return false;
+  int timeout = getWaitTimeout();
+  if (timeout < 0) {
+    return SDL_WaitEvent(ev) != 0;
   }
-  if (qualifiedId.substr(0, groupSize) != group ||
-      qualifiedId[groupSize] != groupNameSeparator ||
-      qualifiedId.substr(groupSize + 1) != id) {
-    return false;
+  if (timeout == 0) {
+    return SDL_PollEvent(ev) != 0;
   }
-  return true;
+  return SDL_WaitEventTimeout(ev, timeout) != 0;
+}
+
+inline Uint64
+State::elementId(Id id) const
+{
+  Uint64 hash = combineId(groupId, id.getHash());
+#ifdef DUI_DEBUG_IDS
+  std::string path = groupPath;
+  if (!path.empty()) {
+    path += '/';
+  }
+  id.appendTo(path);
+  auto [it, inserted] = idPaths.emplace(hash, path);
+  if (!inserted && it->second != path) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                "Id collision between \"%s\" and \"%s\"",
+                it->second.c_str(),
+                path.c_str());
+  }
+#endif
+  return hash;
+}
+
+inline State&
+State::getSubtree(Id id)
+{
+  SDL_assert(inFrame);
+  auto& subtree = cache.get<std::unique_ptr<State>>(elementId(id));
+  if (!subtree) {
+    subtree.reset(new State(SubtreeTag{}, *this));
+  }
+  return *subtree;
+}
+
+inline void
+State::restoreTextures()
+{
+  // The default font is on a page, that gets a new texture
+  size_t fontPage = atlas.getPageCount();
+  for (size_t i = 0; i < atlas.getPageCount(); ++i) {
+    if (atlas.getPage(i) == font.texture) {
+      fontPage = i;
+    }
+  }
+  atlas.restore();
+  if (fontPage < atlas.getPageCount()) {
+    font.texture = atlas.getPage(fontPage);
+  }
+  // Their textures are gone too, not just their contents
+  layerCache.clear();
+  if (canvas) {
+    SDL_DestroyTexture(canvas);
+    canvas = nullptr;
+  }
+  // So the memos don't replay the old textures
+  ++textureResets;
+}
+
+inline void
+State::beginSubtree(State& subtree) const
+{
+  SDL_assert(inFrame);
+  subtree.beginFrame();
+  subtree.ticksCount = ticksCount;
+  subtree.font = font;
+  subtree.textureResets = textureResets;
+  subtree.mPos = mPos;
+  subtree.mLeftPressed = mLeftPressed;
+  subtree.mGrabbing = mGrabbing;
+  subtree.mReleasing = mReleasing;
+  subtree.eGrabbed = subtree.baseGrabbed = eGrabbed;
+  subtree.eActive = subtree.baseActive = eActive;
+  subtree.eHovered = eHovered;
+  std::copy(tEvents, tEvents + tCount, subtree.tEvents);
+  subtree.tCount = tCount;
+  subtree.groupId = groupId;
+  subtree.idStack.assign(idStack.begin(), idStack.end());
+  subtree.clips.assign(clips.begin(), clips.end());
+#ifdef DUI_DEBUG_IDS
+  subtree.groupPath = groupPath;
+  subtree.groupPathSizes = groupPathSizes;
+#endif
+}
+
+inline void
+State::endSubtree(State& subtree)
+{
+  SDL_assert(subtree.inFrame);
+  SDL_assert(subtree.idStack.size() == idStack.size());
+  subtree.inFrame = false;
+  subtree.idStack.clear();
+  subtree.clips.clear();
+#ifdef DUI_DEBUG_IDS
+  subtree.groupPath.clear();
+  subtree.groupPathSizes.clear();
+#endif
+  // In sequence, once an element is grabbed no later subtree changes them,
+  // while the ones before could only clear the active element
+  if (eGrabbed == subtree.baseGrabbed) {
+    if (subtree.eGrabbed != subtree.baseGrabbed) {
+      eGrabbed = subtree.eGrabbed;
+      eActive = subtree.eActive;
+    } else if (subtree.eActive != subtree.baseActive) {
+      eActive = subtree.eActive;
+    }
+  }
+  mGrabbing = mGrabbing || subtree.mGrabbing;
+  mReleasing = mReleasing || subtree.mReleasing;
+  hitIndex.take(subtree.hitIndex);
+  if (subtree.wakeup != 0) {
+    wakeAt(subtree.wakeup);
+  }
+  dList->append(*subtree.dList);
 }
 
 inline MouseAction
-State::checkMouse(std::string_view id, SDL_Rect r)
+State::checkMouse(Id id, SDL_Rect r)
 {
   SDL_assert(inFrame);
-  if (eGrabbed.empty()) {
+  Uint64 elId = elementId(id);
+  r = visibleRect(r);
+  hitIndex.add(elId, r);
+  if (eGrabbed == 0) {
     if (!mLeftPressed) {
       return MouseAction::NONE;
     }
-    if (SDL_PointInRect(&mPos, &r) && !mGrabbing) {
-      eGrabbed = group;
-      eGrabbed += groupNameSeparator;
-      eGrabbed += id;
-      eActive = group;
-      eActive += groupNameSeparator;
-      eActive += id;
-      gGrabbed = true;
-      gActive = true;
+    if (SDL_PointInRect(&mPos, &r) && !mGrabbing && isReachable(elId)) {
+      eGrabbed = elId;
+      eActive = elId;
       mGrabbing = true;
       return MouseAction::GRAB;
     }
-    if (isSameGroupId(eActive, id)) {
-      eActive.clear();
+    if (eActive == elId) {
+      eActive = 0;
     }
     return MouseAction::NONE;
   }
-  if (!isSameGroupId(eGrabbed, id)) {
+  if (eGrabbed != elId) {
     return MouseAction::NONE;
   }
-  gGrabbed = true;
   if (mLeftPressed) {
     if (mGrabbing) {
       return MouseAction::GRAB;
@@ -288,119 +974,206 @@ State::checkMouse(std::string_view id, SDL_Rect r)
 }
 
 inline void
-State::beginGroup(std::string_view id, const SDL_Rect& r)
+State::beginGroup(Id id, const SDL_Rect& r, bool clip)
 {
-  dList.popClip();
+  if (clip) {
+    dList->popClip();
+    // An auto sized side is only known when the group ends, so until then it
+    // is only clipped by the enclosing groups
+    SDL_Rect bounds = r;
+    if (bounds.w == 0) {
+      bounds.w = 1 << 24;
+    }
+    if (bounds.h == 0) {
+      bounds.h = 1 << 24;
+    }
+    clips.push_back(visibleRect(bounds));
+  }
   if (id.empty()) {
     return;
   }
-  auto idSize = id.size();
-  auto groupSize = group.size();
-  if (groupSize > 0) {
-    group += groupNameSeparator;
-    if (!gGrabbed || eGrabbed.size() <= idSize + groupSize + 1 ||
-        std::string_view{eGrabbed}.substr(groupSize, idSize + 1) != id ||
-        eGrabbed[groupSize + idSize + 1] != groupNameSeparator) {
-      gGrabbed = false;
-    }
-    if (!gActive || eActive.size() <= idSize + groupSize + 1 ||
-        std::string_view{eActive}.substr(groupSize, idSize + 1) != id ||
-        eActive[groupSize + idSize + 1] != groupNameSeparator) {
-      gActive = false;
-    }
-  } else {
-    if (eGrabbed.size() <= idSize ||
-        std::string_view{eGrabbed}.substr(0, idSize) != id ||
-        eGrabbed[idSize] != groupNameSeparator) {
-      gGrabbed = false;
-    } else {
-      gGrabbed = true;
-    }
-    if (eActive.size() <= idSize ||
-        std::string_view{eActive}.substr(0, idSize) != id ||
-        eActive[idSize] != groupNameSeparator) {
-      gActive = false;
-    } else {
-      gActive = true;
-    }
+  idStack.push_back(groupId);
+  groupId = combineId(groupId, id.getHash());
+#ifdef DUI_DEBUG_IDS
+  groupPathSizes.push_back(groupPath.size());
+  if (!groupPath.empty()) {
+    groupPath += '/';
   }
-  group += id;
+  id.appendTo(groupPath);
+#endif
 }
 
 inline void
-State::endGroup(std::string_view id, const SDL_Rect& r)
+State::endGroup(Id id, const SDL_Rect& r, bool clip)
 {
-  if (id.empty()) {
-    // Nothing to do
-  } else if (id.size() >= group.size()) {
-    // A top level group
-    SDL_assert(group == id);
-    group.clear();
-    gActive = gGrabbed = false;
-    if (!mHovering && SDL_PointInRect(&mPos, &r)) {
-      mHovering = true;
-    }
-  } else {
-    auto groupSize = group.size();
-    auto nextSize = groupSize - id.size() - 1;
-    SDL_assert(group[nextSize] == groupNameSeparator);
-    SDL_assert(std::string_view{group}.substr(nextSize + 1) == id);
-
-    group.erase(group.begin() + nextSize, group.end());
-    if (!gGrabbed && eGrabbed.size() > nextSize &&
-        std::string_view{eGrabbed}.substr(0, nextSize) == group &&
-        eGrabbed[nextSize] == groupNameSeparator) {
-      gGrabbed = true;
-    }
-    if (!gActive && eActive.size() > nextSize &&
-        std::string_view{eActive}.substr(0, nextSize) == group &&
-        eActive[nextSize] == groupNameSeparator) {
-      gActive = true;
-    }
+  if (clip) {
+    SDL_assert(!clips.empty());
+    clips.pop_back();
+  }
+  if (!id.empty()) {
+    SDL_assert(!idStack.empty());
+    // Below its elements, as they were added before
+    hitIndex.add(groupId, visibleRect(r));
+    groupId = idStack.back();
+    idStack.pop_back();
+#ifdef DUI_DEBUG_IDS
+    groupPath.resize(groupPathSizes.back());
+    groupPathSizes.pop_back();
+#endif
+  }
+  if (clip) {
+    dList->pushClip(r);
   }
-  dList.pushClip(r);
+}
+
+inline void
+State::beginLayer(Id id)
+{
+  SDL_assert(inFrame);
+  Uint64 key = elementId(id);
+  auto& content = cache.get<LayerLists>(key).lists[current];
+  content.clear();
+  layerStack.push_back({dList, key});
+  dList = &content;
+}
+
+inline void
+State::endLayer()
+{
+  SDL_assert(!layerStack.empty());
+  auto layer = layerStack.back();
+  layerStack.pop_back();
+  auto& content = *dList;
+  dList = layer.parent;
+  dList->insertLayer(content, layer.key);
+}
+
+inline bool
+State::beginMemo(Id id, const SDL_Point& pos, Uint64 deps, SDL_Point* size)
+{
+  SDL_assert(inFrame);
+  auto& record = cache.get<MemoRecord>(elementId(id));
+  // Its elements were added in absolute coordinates, with the current font
+  SDL_Rect clip = clips.empty() ? SDL_Rect{0, 0, 0, 0} : clips.back();
+  Uint64 key = combineId(deps, Uint64(Uint32(pos.x)) << 32 | Uint32(pos.y));
+  key = combineId(key, Uint64(Uint32(clip.x)) << 32 | Uint32(clip.y));
+  key = combineId(key, Uint64(Uint32(clip.w)) << 32 | Uint32(clip.h));
+  key = combineId(key, Uint64(uintptr_t(font.texture)));
+  key = combineId(key, textureResets);
+  key = combineId(key,
+                  Uint64(Uint32(font.origin.x)) << 32 | Uint32(font.origin.y));
+
+  SDL_Rect visible = visibleRect({pos.x, pos.y, record.size.x, record.size.y});
+  if (record.key == key && !record.mouseInside &&
+      !SDL_PointInRect(&mPos, &visible) &&
+      (eGrabbed == 0 || !record.hits.isPending(eGrabbed)) &&
+      (eActive == 0 || !record.hits.isPending(eActive)) &&
+      record.list.getLayerCount() == 0) {
+    dList->append(record.list);
+    hitIndex.copyPending(record.hits);
+    // Otherwise the elements' cached values would expire, as nothing gets them
+    cache.touch(record.cacheKeys);
+    *size = record.size;
+    return false;
+  }
+  memoStack.push_back({dList,
+                       &record,
+                       hitIndex.getPendingCount(),
+                       cache.beginTracking(),
+                       key,
+                       pos});
+  record.list.clear();
+  dList = &record.list;
+  return true;
+}
+
+inline void
+State::endMemo(const SDL_Point& size)
+{
+  SDL_assert(!memoStack.empty());
+  auto memo = memoStack.back();
+  memoStack.pop_back();
+  auto& record = *memo.record;
+  dList = memo.parent;
+  dList->append(record.list);
+  record.hits.clearPending();
+  record.hits.copyPending(hitIndex, memo.firstHit);
+  cache.endTracking(memo.firstKey, &record.cacheKeys);
+  record.key = memo.key;
+  record.size = size;
+  SDL_Rect visible = visibleRect({memo.pos.x, memo.pos.y, size.x, size.y});
+  record.mouseInside = SDL_PointInRect(&mPos, &visible);
 }
 
 inline void
 State::event(SDL_Event& ev)
 {
-  if (ev.type == SDL_MOUSEBUTTONDOWN) {
-    mPos = {ev.button.x, ev.button.y};
-    if (ev.button.button == SDL_BUTTON_LEFT) {
-      mLeftPressed = true;
-    }
+  if (ev.type == SDL_MOUSEBUTTONDOWN || ev.type == SDL_MOUSEBUTTONUP) {
+    mNextPos = {ev.button.x, ev.button.y};
+    input.push(ev);
   } else if (ev.type == SDL_MOUSEMOTION) {
-    if (!(eGrabbed.empty() && mLeftPressed)) {
-      mPos = {ev.motion.x, ev.motion.y};
+    mNextPos = {ev.motion.x, ev.motion.y};
+    input.push(ev);
+  } else if (ev.type == SDL_TEXTINPUT || ev.type == SDL_KEYDOWN) {
+    // Only useful if something is active or a queued click can activate it
+    if (eActive != 0 || input.contains(SDL_MOUSEBUTTONDOWN)) {
+      input.push(ev);
     }
-  } else if (ev.type == SDL_MOUSEBUTTONUP) {
-    mPos = {ev.button.x, ev.button.y};
-    mLeftPressed = false;
-  } else if (ev.type == SDL_TEXTINPUT) {
-    if (eActive.empty()) {
-      return;
+  } else if (ev.type == SDL_WINDOWEVENT ||
+             ev.type == SDL_RENDER_TARGETS_RESET ||
+             ev.type == SDL_RENDER_DEVICE_RESET) {
+    if (ev.type == SDL_RENDER_DEVICE_RESET) {
+      deviceReset = true;
     }
-    for (int i = 0, j = 0; i < SDL_TEXTINPUTEVENT_TEXT_SIZE; ++i) {
-      tBuffer[j] = ev.text.text[i];
-      if (tBuffer[j] == 0) {
-        break;
+    invalidate();
+  }
+}
+
+inline void
+State::takeInput()
+{
+  tCount = 0;
+  tookInput = !input.empty();
+  for (; !input.empty(); input.pop()) {
+    auto& ev = input.front();
+    if (ev.type == SDL_MOUSEBUTTONDOWN || ev.type == SDL_MOUSEBUTTONUP) {
+      if (ev.button.button == SDL_BUTTON_LEFT) {
+        // The text before is for the element active before it
+        if (tCount == 0) {
+          mPos = {ev.button.x, ev.button.y};
+          mLeftPressed = ev.type == SDL_MOUSEBUTTONDOWN;
+          input.pop();
+        }
+        return;
       }
-      // Magic handling of utf8
-      if ((tBuffer[j] & 0xc0) == 0x80) {
-        continue;
+      mPos = {ev.button.x, ev.button.y};
+    } else if (ev.type == SDL_MOUSEMOTION) {
+      if (!(eGrabbed == 0 && mLeftPressed)) {
+        mPos = {ev.motion.x, ev.motion.y};
       }
-      if ((tBuffer[j] & 0x80) != 0) {
-        tBuffer[j] = '\x0f'; // This is valid on our particular font
+    } else if (ev.type == SDL_TEXTINPUT) {
+      auto& tEvent = tEvents[tCount++];
+      tEvent.action = TextAction::INPUT;
+      tEvent.keysym = {};
+      for (int i = 0, j = 0; i < SDL_TEXTINPUTEVENT_TEXT_SIZE; ++i) {
+        tEvent.text[j] = ev.text.text[i];
+        if (tEvent.text[j] == 0) {
+          break;
+        }
+        // Magic handling of utf8
+        if ((tEvent.text[j] & 0xc0) == 0x80) {
+          continue;
+        }
+        if ((tEvent.text[j] & 0x80) != 0) {
+          tEvent.text[j] = '\x0f'; // This is valid on our particular font
+        }
+        ++j;
       }
-      ++j;
-    }
-    tChanged = true;
-    tAction = TextAction::INPUT;
-  } else if (ev.type == SDL_KEYDOWN) {
-    if (!tChanged) {
-      tKeysym = ev.key.keysym;
-      tChanged = true;
-      tAction = TextAction::KEYDOWN;
+    } else if (ev.type == SDL_KEYDOWN) {
+      auto& tEvent = tEvents[tCount++];
+      tEvent.action = TextAction::KEYDOWN;
+      tEvent.keysym = ev.key.keysym;
+      tEvent.text[0] = 0;
     }
   }
 }
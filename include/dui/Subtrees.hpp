@@ -0,0 +1,153 @@
+#ifndef DUI_SUBTREES_HPP_
+#define DUI_SUBTREES_HPP_
+
+#include <vector>
+#include "FrameArena.hpp"
+#include "State.hpp"
+#include "Target.hpp"
+#include "ThreadPool.hpp"
+
+namespace dui {
+
+/**
+ * @brief Builds independent parts of a target in parallel
+ *
+ * Each subtree is a callable with the signature `void(Target)`, that adds its
+ * elements to the given target, usually a single window() or panel(). On
+ * build() they run on a ThreadPool, each with its own State, holding its
+ * display list and element cache, and then their display lists are appended
+ * to the target's in the order they were added. The result renders exactly as
+ * if they were built in sequence.
+ *
+ * The rules for sharing data are:
+ * - A subtree can only use the target it is given and data no other subtree
+ *   writes. The subtree States are only synchronized on build();
+ * - Nothing else can be added to the target between the first add() and
+ *   build();
+ * - The target must have Layout::NONE, as a subtree can't know where the
+ *   previous ones ended, and the subtrees should not depend on its size;
+ * - All subtrees see the input as it was before build(). If they overlap, more
+ *   than one might see the same click, but only the first added keeps the
+ *   grab;
+ * - The callables are copied to the frame arena, and destroyed when it is
+ *   reset on a later frame.
+ *
+ * If not built explicitly, the destructor builds them in sequence.
+ */
+class Subtrees
+{
+  struct Job
+  {
+    void (*call)(const void*, Target);
+    const void* data;
+    State* state;
+    SDL_Rect rect;
+    SDL_Point topLeft;
+    SDL_Point bottomRight;
+    bool locked;
+  };
+  Target target;
+  std::pmr::vector<Job> jobs;
+
+public:
+  /**
+   * @brief Ctor
+   *
+   * @param target the target where the subtrees are added. Its layout must be
+   * Layout::NONE.
+   */
+  explicit Subtrees(Target target)
+    : target(target)
+    , jobs(target.getState().getFrameResource())
+  {
+    SDL_assert(target.getLayout() == Layout::NONE);
+  }
+
+  Subtrees(const Subtrees&) = delete;
+  Subtrees& operator=(const Subtrees&) = delete;
+
+  ~Subtrees()
+  {
+    if (!jobs.empty()) {
+      build();
+    }
+  }
+
+  /**
+   * @brief Add a subtree
+   *
+   * @param id identifies the subtree between frames, to keep its State. It
+   * does not change the ids of the elements inside it.
+   * @param func a callable with the signature `void(Target)`. It is kept on
+   * the frame arena.
+   */
+  template<class FUNC>
+  void add(Id id, FUNC func);
+
+  /// Build the subtrees in parallel on pool and append them to the target
+  void build(ThreadPool& pool) { build(&pool); }
+
+  /// Build the subtrees in sequence on this thread
+  void build() { build(nullptr); }
+
+private:
+  void build(ThreadPool* pool);
+};
+
+template<class FUNC>
+inline void
+Subtrees::add(Id id, FUNC func)
+{
+  SDL_assert(!target.isLocked());
+  auto& state = target.getState();
+  auto data = arenaNew(state.getFrameArena(), std::move(func));
+
+  auto caret = target.getCaret();
+  jobs.push_back({[](const void* data, Target target) {
+                    (*static_cast<const FUNC*>(data))(target);
+                  },
+                  data,
+                  &state.getSubtree(id),
+                  target.getRect(),
+                  caret,
+                  {caret.x + target.contentWidth(),
+                   caret.y + target.contentHeight()},
+                  false});
+}
+
+inline void
+Subtrees::build(ThreadPool* pool)
+{
+  auto& state = target.getState();
+  for (auto& job : jobs) {
+    state.beginSubtree(*job.state);
+  }
+  auto buildJob = [this](size_t index, size_t) {
+    auto& job = jobs[index];
+    job.call(job.data,
+             {job.state,
+              {},
+              job.rect,
+              job.topLeft,
+              job.bottomRight,
+              job.locked,
+              {0, Layout::NONE}});
+  };
+  if (pool) {
+    pool->run(jobs.size(), buildJob);
+  } else {
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      buildJob(i, 0);
+    }
+  }
+  for (auto& job : jobs) {
+    state.endSubtree(*job.state);
+    target.advance(
+      {job.bottomRight.x - job.topLeft.x, job.bottomRight.y - job.topLeft.y});
+  }
+  jobs.clear();
+}
+
+} // namespace dui
+
+#endif // DUI_SUBTREES_HPP_
@@ -14,7 +14,7 @@ namespace dui {
 class Target
 {
   State* state;
-  std::string_view id;
+  Id id;
   SDL_Rect* rect = nullptr;
   SDL_Point* topLeft = nullptr;
   SDL_Point* bottomRight = nullptr;
@@ -42,7 +42,7 @@ public:
 
   /// Ctor
   Target(State* state,
-         std::string_view id,
+         Id id,
          SDL_Rect& rect,
          SDL_Point& topLeft,
          SDL_Point& bottomRight,
@@ -64,7 +64,7 @@ public:
    * @param r the element local rect (Use State.checkMouse() for global rect)
    * @return MouseAction
    */
-  MouseAction checkMouse(std::string_view id, SDL_Rect r);
+  MouseAction checkMouse(Id id, SDL_Rect r);
 
   /**
    * @brief Check if given contained element is active
@@ -73,7 +73,15 @@ public:
    * @return true
    * @return false
    */
-  bool isActive(std::string_view id) const { return state->isActive(id); }
+  bool isActive(Id id) const { return state->isActive(id); }
+
+  /**
+   * @brief Check if given contained element was the topmost under the mouse
+   *
+   * @param id the id to check
+   * @see State.isHovered()
+   */
+  bool isHovered(Id id) const { return state->isHovered(id); }
 
   /**
    * @brief Check the text action/status for element in this group
@@ -81,10 +89,24 @@ public:
    * @param id the element id
    * @return TextAction
    */
-  TextAction checkText(std::string_view id) const
-  {
-    return state->checkText(id);
-  }
+  TextAction checkText(Id id) const { return state->checkText(id); }
+
+  /**
+   * @brief The text events for the contained element in this frame
+   *
+   * @param id the element id
+   * @see State.textEvents()
+   */
+  TextEvents textEvents(Id id) const { return state->textEvents(id); }
+
+  /**
+   * @brief Data of type T kept for the contained element between frames
+   *
+   * @param id the element id
+   * @see State.getCached()
+   */
+  template<class T>
+  T& getCached(Id id) const { return state->getCached<T>(id); }
 
   /**
    * @brief Get the last input text
@@ -198,24 +220,24 @@ public:
   int contentHeight() const { return bottomRight->y - topLeft->y; }
 
   /// To be used internally
-  void lock(std::string_view id, SDL_Rect r)
+  void lock(Id id, SDL_Rect r, bool clip = true)
   {
     SDL_assert(!*locked);
     *locked = true;
     auto caret = getCaret();
     r.x += caret.x;
     r.y += caret.y;
-    state->beginGroup(id, r);
+    state->beginGroup(id, r, clip);
   }
 
   /// To be used internally
-  void unlock(std::string_view id, SDL_Rect r)
+  void unlock(Id id, SDL_Rect r, bool clip = true)
   {
     SDL_assert(*locked);
     auto caret = getCaret();
     r.x += caret.x;
     r.y += caret.y;
-    state->endGroup(id, r);
+    state->endGroup(id, r, clip);
     *locked = false;
   }
 
@@ -224,7 +246,7 @@ public:
 };
 
 inline MouseAction
-Target::checkMouse(std::string_view id, SDL_Rect r)
+Target::checkMouse(Id id, SDL_Rect r)
 {
   SDL_assert(!*locked);
   SDL_Point caret = getCaret();
@@ -49,10 +49,7 @@ character(Target target,
                    font.charW << style.scale,
                    font.charH << style.scale};
   target.advance({p.x + dstRect.w, p.y + dstRect.h});
-  SDL_Rect srcRect{(ch % font.cols) * font.charW,
-                   (ch / font.cols) * font.charH,
-                   font.charW,
-                   font.charH};
+  SDL_Rect srcRect = font.glyph(ch);
   state.display(Shape::Texture(dstRect, font.texture, srcRect, style.color));
 }
 
@@ -78,19 +75,10 @@ text(Target target,
   SDL_assert(font.texture != nullptr);
 
   auto caret = target.getCaret();
-  SDL_Rect dstRect{p.x + caret.x,
-                   p.y + caret.y,
-                   font.charW << style.scale,
-                   font.charH << style.scale};
-  target.advance({p.x + dstRect.w * int(str.size()), p.y + dstRect.h});
-  for (auto ch : str) {
-    SDL_Rect srcRect{(ch % font.cols) * font.charW,
-                     (ch / font.cols) * font.charH,
-                     font.charW,
-                     font.charH};
-    state.display(Shape::Texture(dstRect, font.texture, srcRect, style.color));
-    dstRect.x += dstRect.w;
-  }
+  auto sz = measure(str, font, style.scale);
+  target.advance({p.x + sz.x, p.y + sz.y});
+  state.displayText(
+    str, {p.x + caret.x, p.y + caret.y}, font, style.scale, style.color);
 }
 } // namespace dui
 
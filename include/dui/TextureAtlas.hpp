@@ -0,0 +1,344 @@
+#ifndef DUI_TEXTURE_ATLAS_HPP_
+#define DUI_TEXTURE_ATLAS_HPP_
+
+#include <algorithm>
+#include <vector>
+#include <SDL.h>
+
+namespace dui {
+
+class TextureAtlas;
+
+/**
+ * @brief An image on a TextureAtlas page, see TextureAtlas.add()
+ *
+ * It refers to the page by index, so it stays valid when restore() creates
+ * the page textures again.
+ */
+struct AtlasImage
+{
+  const TextureAtlas* atlas; ///< The atlas it was added to
+  size_t page;               ///< The index of the page it is on
+  SDL_Rect rect;             ///< Where it is on the page
+
+  /// The texture of its page, or nullptr if none
+  SDL_Texture* getTexture() const;
+
+  /// If it was added successfully
+  explicit operator bool() const { return atlas != nullptr; }
+};
+
+/**
+ * @brief Packs many small images on a few big textures
+ *
+ * Each texture is a batch break and a state change when rendering, so drawing
+ * a toolbar of icons on their own textures takes as many draws as icons. Added
+ * to an atlas, all of them and the font share a page and the display list
+ * draws them together.
+ *
+ * The images are placed bottom-left on the skyline of each page, the first
+ * that fits, and a new page is added when none does. Images bigger than the
+ * page size get a page of their own. They can't be removed, only all at once
+ * with clear().
+ *
+ * A copy of the pages' pixels is kept, to create their textures again with
+ * restore() after the renderer lost them, and to give them to a
+ * SoftwareRenderer.
+ *
+ * The pages are textures of the renderer, so it follows the same threading
+ * rules (see RenderThread).
+ */
+class TextureAtlas
+{
+  static constexpr int PADDING = 1; ///< Transparent pixels between images
+
+  struct Segment
+  {
+    int x, y, w;
+  };
+  struct Page
+  {
+    SDL_Texture* texture;
+    int w, h;
+    std::vector<Uint32> pixels;  ///< ARGB8888, row by row
+    std::vector<Segment> skyline; ///< The top of the used area, left to right
+  };
+  std::vector<Page> pages;
+  SDL_Renderer* renderer;
+  int pageSize;
+
+public:
+  /**
+   * @brief Ctor
+   *
+   * No texture is created until an image is added.
+   *
+   * @param renderer the renderer the pages are created on
+   * @param pageSize the width and height of each page
+   */
+  explicit TextureAtlas(SDL_Renderer* renderer, int pageSize = 512)
+    : renderer(renderer)
+    , pageSize(pageSize)
+  {}
+
+  TextureAtlas(const TextureAtlas&) = delete;
+  TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+  ~TextureAtlas() { clear(); }
+
+  /**
+   * @brief Add the pixels of surface
+   *
+   * A color key is turned into alpha, like SDL_CreateTextureFromSurface()
+   * does.
+   *
+   * @param surface the image, it is copied
+   * @return AtlasImage where it was placed, false on failure
+   */
+  AtlasImage add(SDL_Surface* surface);
+
+  /**
+   * @brief Add an image
+   *
+   * @param pixels its contents in ARGB8888, copied
+   * @param w the width
+   * @param h the height
+   * @param pitch bytes between rows
+   * @return AtlasImage where it was placed, false on failure
+   */
+  AtlasImage add(const Uint32* pixels, int w, int h, int pitch);
+
+  /**
+   * @brief Create the page textures again, from their pixels
+   *
+   * Needed after a SDL_RENDER_DEVICE_RESET, as the renderer drops all
+   * textures. The images stay valid, but getPage() gives the new textures.
+   *
+   * @return true on success, false if a page could not be created, see
+   * SDL_GetError()
+   */
+  bool restore();
+
+  /// Destroy all pages, invalidating every image added
+  void clear()
+  {
+    for (auto& page : pages) {
+      SDL_DestroyTexture(page.texture);
+    }
+    pages.clear();
+  }
+
+  /// Number of pages
+  size_t getPageCount() const { return pages.size(); }
+
+  /// The texture of the page with the given index
+  SDL_Texture* getPage(size_t index) const { return pages[index].texture; }
+
+  /// The pixels of the page with the given index, getPageSize() of them
+  const Uint32* getPagePixels(size_t index) const
+  {
+    return pages[index].pixels.data();
+  }
+
+  /// The size of the page with the given index
+  SDL_Point getPageSize(size_t index) const
+  {
+    return {pages[index].w, pages[index].h};
+  }
+
+private:
+  /// The y where a w by h rect starting on the segment fits, or -1
+  static int fit(const Page& page, size_t segment, int w, int h);
+
+  /// Raise the skyline where a w by h rect was placed on the segment
+  static void place(Page& page, size_t segment, int w, int h);
+
+  /// Add a page big enough for a w by h rect, or return nullptr
+  Page* addPage(int w, int h);
+
+  /// Create the texture of a page, or return nullptr
+  SDL_Texture* createTexture(int w, int h);
+};
+
+inline SDL_Texture*
+AtlasImage::getTexture() const
+{
+  // After a clear() the page might not exist anymore
+  if (!atlas || page >= atlas->getPageCount()) {
+    return nullptr;
+  }
+  return atlas->getPage(page);
+}
+
+inline AtlasImage
+TextureAtlas::add(SDL_Surface* surface)
+{
+  if (!surface) {
+    return {nullptr, 0, {0}};
+  }
+  SDL_Surface* converted =
+    SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (!converted) {
+    return {nullptr, 0, {0}};
+  }
+  SDL_LockSurface(converted);
+  auto image = add(static_cast<const Uint32*>(converted->pixels),
+                   converted->w,
+                   converted->h,
+                   converted->pitch);
+  SDL_UnlockSurface(converted);
+  SDL_FreeSurface(converted);
+  return image;
+}
+
+inline AtlasImage
+TextureAtlas::add(const Uint32* pixels, int w, int h, int pitch)
+{
+  if (w <= 0 || h <= 0) {
+    return {nullptr, 0, {0}};
+  }
+  int paddedW = w + PADDING;
+  int paddedH = h + PADDING;
+  Page* best = nullptr;
+  size_t bestSegment = 0;
+  int bestY = 0;
+  for (auto& page : pages) {
+    for (size_t i = 0; i < page.skyline.size(); ++i) {
+      int y = fit(page, i, paddedW, paddedH);
+      if (y >= 0 && (!best || y < bestY)) {
+        best = &page;
+        bestSegment = i;
+        bestY = y;
+      }
+    }
+    if (best) {
+      break;
+    }
+  }
+  if (!best) {
+    best = addPage(paddedW, paddedH);
+    if (!best) {
+      return {nullptr, 0, {0}};
+    }
+  }
+  SDL_Rect rect{best->skyline[bestSegment].x, bestY, w, h};
+  place(*best, bestSegment, paddedW, paddedH);
+
+  auto bytes = static_cast<const Uint8*>(static_cast<const void*>(pixels));
+  for (int y = 0; y < h; ++y) {
+    SDL_memcpy(&best->pixels[size_t(rect.y + y) * best->w + rect.x],
+               bytes + size_t(y) * pitch,
+               size_t(w) * sizeof(Uint32));
+  }
+  // The padding goes too, as the texture starts with undefined pixels
+  SDL_Rect padded{rect.x,
+                  rect.y,
+                  std::min(paddedW, best->w - rect.x),
+                  std::min(paddedH, best->h - rect.y)};
+  if (SDL_UpdateTexture(best->texture,
+                        &padded,
+                        &best->pixels[size_t(rect.y) * best->w + rect.x],
+                        best->w * 4) < 0) {
+    return {nullptr, 0, {0}};
+  }
+  return {this, size_t(best - pages.data()), rect};
+}
+
+inline bool
+TextureAtlas::restore()
+{
+  bool restored = true;
+  for (auto& page : pages) {
+    SDL_DestroyTexture(page.texture);
+    page.texture = createTexture(page.w, page.h);
+    if (!page.texture ||
+        SDL_UpdateTexture(
+          page.texture, nullptr, page.pixels.data(), page.w * 4) < 0) {
+      restored = false;
+    }
+  }
+  return restored;
+}
+
+inline int
+TextureAtlas::fit(const Page& page, size_t segment, int w, int h)
+{
+  int x = page.skyline[segment].x;
+  // The last column and row can go without padding
+  if (x + w - PADDING > page.w) {
+    return -1;
+  }
+  int y = 0;
+  for (size_t i = segment; i < page.skyline.size(); ++i) {
+    auto& s = page.skyline[i];
+    if (s.x >= x + w) {
+      break;
+    }
+    y = std::max(y, s.y);
+  }
+  return y + h - PADDING > page.h ? -1 : y;
+}
+
+inline void
+TextureAtlas::place(Page& page, size_t segment, int w, int h)
+{
+  auto& skyline = page.skyline;
+  int x = skyline[segment].x;
+  int y = fit(page, segment, w, h);
+  w = std::min(w, page.w - x);
+  skyline.insert(skyline.begin() + segment, Segment{x, y + h, w});
+
+  // Shrink or remove the segments now below it
+  size_t i = segment + 1;
+  while (i < skyline.size() && skyline[i].x < x + w) {
+    int overlap = x + w - skyline[i].x;
+    if (overlap < skyline[i].w) {
+      skyline[i].x += overlap;
+      skyline[i].w -= overlap;
+      break;
+    }
+    skyline.erase(skyline.begin() + i);
+  }
+  // Merge neighbours at the same height
+  for (size_t j = 1; j < skyline.size();) {
+    if (skyline[j - 1].y == skyline[j].y) {
+      skyline[j - 1].w += skyline[j].w;
+      skyline.erase(skyline.begin() + j);
+    } else {
+      ++j;
+    }
+  }
+}
+
+inline TextureAtlas::Page*
+TextureAtlas::addPage(int w, int h)
+{
+  w = std::max(w, pageSize);
+  h = std::max(h, pageSize);
+  auto texture = createTexture(w, h);
+  if (!texture) {
+    return nullptr;
+  }
+  auto& page = pages.emplace_back();
+  page.texture = texture;
+  page.w = w;
+  page.h = h;
+  page.pixels.assign(size_t(w) * h, 0);
+  page.skyline.push_back({0, 0, w});
+  return &page;
+}
+
+inline SDL_Texture*
+TextureAtlas::createTexture(int w, int h)
+{
+  auto texture = SDL_CreateTexture(
+    renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+  if (texture) {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  }
+  return texture;
+}
+
+} // namespace dui
+
+#endif // DUI_TEXTURE_ATLAS_HPP_
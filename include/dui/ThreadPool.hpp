@@ -0,0 +1,149 @@
+#ifndef DUI_THREAD_POOL_HPP_
+#define DUI_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dui {
+
+/**
+ * @brief A fixed set of worker threads running parallel loops
+ *
+ * The threads are started once and sleep between calls to run(), so it is
+ * cheap enough to use every frame.
+ */
+class ThreadPool
+{
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping = false;
+  unsigned generation = 0; ///< Incremented on each run()
+  size_t running = 0;      ///< Workers that didn't finish the current run()
+
+  // The current job
+  void (*call)(void*, size_t, size_t) = nullptr;
+  void* context = nullptr;
+  size_t count = 0;
+  std::atomic<size_t> next{0};
+
+public:
+  /**
+   * @brief Ctor
+   *
+   * @param threads how many threads run the loops, including the one calling
+   * run(). If 1 or less, run() does everything on the calling thread.
+   */
+  explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool();
+
+  /// The number of threads, including the one calling run()
+  size_t size() const { return workers.size() + 1; }
+
+  /**
+   * @brief Call func(index, thread) for each index in [0, count)
+   *
+   * The indices are taken in order by whichever thread is free, so the
+   * order they finish is unspecified. The thread is in [0, size()), 0 being
+   * the calling one, and can be used to pick per thread scratch data.
+   *
+   * It returns after all calls are done. It must not be called concurrently
+   * nor from inside func.
+   */
+  template<class FUNC>
+  void run(size_t count, FUNC&& func);
+
+private:
+  void work(size_t thread);
+
+  void loop(size_t thread);
+};
+
+inline ThreadPool::ThreadPool(unsigned threads)
+{
+  for (unsigned i = 1; i < threads; ++i) {
+    workers.emplace_back([this, i] { loop(i); });
+  }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+template<class FUNC>
+inline void
+ThreadPool::run(size_t count, FUNC&& func)
+{
+  using Func = std::remove_reference_t<FUNC>;
+  if (workers.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      func(i, 0);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    call = [](void* context, size_t index, size_t thread) {
+      (*static_cast<Func*>(context))(index, thread);
+    };
+    context = &func;
+    this->count = count;
+    next = 0;
+    running = workers.size();
+    ++generation;
+  }
+  wake.notify_all();
+  work(0);
+  std::unique_lock<std::mutex> lock{mutex};
+  done.wait(lock, [this] { return running == 0; });
+}
+
+inline void
+ThreadPool::work(size_t thread)
+{
+  for (size_t i = next++; i < count; i = next++) {
+    call(context, i, thread);
+  }
+}
+
+inline void
+ThreadPool::loop(size_t thread)
+{
+  unsigned seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      wake.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+    work(thread);
+    std::lock_guard<std::mutex> lock{mutex};
+    if (--running == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+} // namespace dui
+
+#endif // DUI_THREAD_POOL_HPP_
@@ -3,6 +3,7 @@
 #include <string_view>
 #include "Element.hpp"
 #include "Group.hpp"
+#include "Layer.hpp"
 #include "Panel.hpp"
 #include "WindowStyle.hpp"
 #include "Wrapper.hpp"
@@ -15,6 +16,7 @@ class WindowImpl : public Targetable<WindowImpl<CLIENT>>
 {
   WindowDecorationStyle style;
   std::string_view title;
+  Layer layer; ///< Before wrapper, so it encloses it
   Wrapper<CLIENT> wrapper;
 
   constexpr EdgeSize makeWrapperPadding()
@@ -30,19 +32,21 @@ public:
   /// Window ctor
   template<class FUNC>
   WindowImpl(Target parent,
-             std::string_view id,
+             Id id,
              std::string_view title,
              const SDL_Rect& r,
              FUNC initializer,
              const WindowDecorationStyle& style)
     : style(style)
     , title(title)
+    , layer(parent, id, style.panel.cached)
     , wrapper(parent, id, r, makeWrapperPadding(), initializer)
   {}
   /// Move ctor
   WindowImpl(WindowImpl&& rhs)
     : style(rhs.style)
     , title(rhs.title)
+    , layer(std::move(rhs.layer))
     , wrapper(std::move(rhs.wrapper))
   {}
 
@@ -69,6 +73,7 @@ public:
     centeredLabel(wrapper, title, {0, 0, sz.x, 0}, style);
     box(wrapper, {0, 0, sz.x, sz.y}, style);
     wrapper.end();
+    layer.end();
   }
 
   /// Returns a target object to this
@@ -113,7 +118,7 @@ makeWindowRect(const SDL_Rect& r, Target target)
  */
 inline WindowImpl<Group>
 window(Target target,
-       std::string_view id,
+       Id id,
        std::string_view title,
        const SDL_Rect& r = {0},
        const WindowStyle& style = themeFor<Window>())
@@ -143,7 +148,7 @@ window(Target target,
 /// @ingroup groups
 inline WindowImpl<Group>
 window(Target target,
-       std::string_view id,
+       Id id,
        std::string_view title,
        const SDL_Rect& r,
        Layout layout,
@@ -182,7 +187,7 @@ window(Target target,
 inline WindowImpl<Scrollable>
 scrollableWindow(
   Target target,
-  std::string_view id,
+  Id id,
   std::string_view title,
   SDL_Point* scrollOffset,
   const SDL_Rect& r = {0},
@@ -216,7 +221,7 @@ scrollableWindow(
 inline WindowImpl<Scrollable>
 scrollableWindow(
   Target target,
-  std::string_view id,
+  Id id,
   std::string_view title,
   SDL_Point* scrollOffset,
   const SDL_Rect& r,
@@ -49,6 +49,10 @@ struct WindowDecorationStyle
   {
     return withPanel(panel.withBorderColor(border));
   }
+  constexpr WindowDecorationStyle withCached(bool cached) const
+  {
+    return withPanel(panel.withCached(cached));
+  }
 };
 
 struct WindowStyle
@@ -90,6 +94,10 @@ struct WindowStyle
   {
     return withDecoration(decoration.withBorderColor(border));
   }
+  constexpr WindowStyle withCached(bool cached) const
+  {
+    return withDecoration(decoration.withCached(cached));
+  }
 
   constexpr WindowStyle withElementSpacing(int elementSpacing) const
   {
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <functional>
 #include "EdgeSize.hpp"
+#include "FrameArena.hpp"
 #include "Group.hpp"
 
 namespace dui {
@@ -10,9 +10,11 @@ namespace dui {
 template<class CLIENT>
 class Wrapper : public Targetable<Wrapper<CLIENT>>
 {
-  using ClientInitializer = std::function<CLIENT(Target, const SDL_Rect&)>;
+  /// Calls the initializer, that lives on the frame arena
+  using ClientInitializer = CLIENT (*)(const void*, Target, const SDL_Rect&);
   EdgeSize padding;
   ClientInitializer initializer;
+  const void* initializerData;
   Group decoration;
   CLIENT client;
   bool onClient = false;
@@ -30,15 +32,33 @@ class Wrapper : public Targetable<Wrapper<CLIENT>>
   }
 
 public:
+  /**
+   * @brief Ctor
+   *
+   * @param parent the parent target
+   * @param id the wrapper id
+   * @param rect the wrapper rect
+   * @param padding the space between the wrapper and the client
+   * @param initializer a callable with the signature
+   * `CLIENT(Target, const SDL_Rect&)` to create the client. It might be
+   * called again when the wrapper is moved. It is kept on the frame arena.
+   */
+  template<class FUNC>
   Wrapper(Target parent,
-          std::string_view id,
+          Id id,
           const SDL_Rect& rect,
           const EdgeSize& padding,
-          ClientInitializer initializer)
+          FUNC initializer)
     : padding(padding)
-    , initializer(initializer)
+    , initializer([](const void* data, Target target, const SDL_Rect& r) {
+      return CLIENT{(*static_cast<const FUNC*>(data))(target, r)};
+    })
+    , initializerData(
+        arenaNew(parent.getState().getFrameArena(), std::move(initializer)))
     , decoration(parent, id, {0}, rect, {0, Layout::NONE})
-    , client(this->initializer(decoration, paddedSize(rect, padding)))
+    , client(this->initializer(initializerData,
+                               decoration,
+                               paddedSize(rect, padding)))
     , autoW(rect.w == 0)
     , autoH(rect.h == 0)
   {
@@ -48,8 +68,11 @@ public:
   Wrapper(Wrapper&& rhs)
     : padding(rhs.padding)
     , initializer(rhs.initializer)
+    , initializerData(rhs.initializerData)
     , decoration(std::move(rhs.decoration))
-    , client(initializer(decoration, paddedSize(decoration.getRect(), padding)))
+    , client(initializer(initializerData,
+                         decoration,
+                         paddedSize(decoration.getRect(), padding)))
     , onClient(rhs.onClient)
     , autoW(rhs.autoW)
     , autoH(rhs.autoH)
@@ -2,19 +2,32 @@
 #define DUI_HPP_
 
 #include "Button.hpp"
+#include "CoverageGrid.hpp"
 #include "DisplayList.hpp"
 #include "Element.hpp"
+#include "ElementCache.hpp"
 #include "Font.hpp"
 #include "Frame.hpp"
 #include "Group.hpp"
+#include "HitIndex.hpp"
+#include "Id.hpp"
 #include "InputBox.hpp"
+#include "InputQueue.hpp"
 #include "InputField.hpp"
 #include "Label.hpp"
+#include "Layer.hpp"
+#include "LayerCache.hpp"
+#include "Memo.hpp"
 #include "Panel.hpp"
+#include "RenderThread.hpp"
 #include "Scrollable.hpp"
 #include "SliderBox.hpp"
 #include "SliderField.hpp"
+#include "SoftwareRenderer.hpp"
 #include "State.hpp"
+#include "Subtrees.hpp"
+#include "TextureAtlas.hpp"
+#include "ThreadPool.hpp"
 #include "Window.hpp"
 #include "Wrapper.hpp"
 
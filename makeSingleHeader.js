@@ -10,11 +10,13 @@ fs.writeSync(output, copywrite.replace(/\n/g, '\n * '))
 fs.writeSync(output, "\n */\n", undefined)
 fs.writeSync(output, "#ifndef DUI_SINGLE_HPP\n", undefined)
 fs.writeSync(output, "#define DUI_SINGLE_HPP\n\n", undefined)
-fs.writeSync(output, "#include <algorithm>\n", undefined)
-fs.writeSync(output, "#include <string>\n", undefined)
-fs.writeSync(output, "#include <string_view>\n", undefined)
-fs.writeSync(output, "#include <vector>\n", undefined)
-fs.writeSync(output, "#include <SDL.h>\n\n", undefined)
+for (const systemInclude of getSystemIncludes(fileQueue)) {
+  fs.writeSync(output, `${systemInclude}\n`)
+}
+for (const block of getConditionalIncludes(fileQueue)) {
+  fs.writeSync(output, `\n${block}\n`)
+}
+fs.writeSync(output, "\n", undefined)
 fs.writeSync(output, "namespace dui {\n\n", undefined)
 fs.writeSync(output, "#ifndef DUI_THEME\n", undefined)
 fs.writeSync(output, "#define DUI_THEME dui::style::SteelBlue\n", undefined)
@@ -23,8 +25,7 @@ fs.writeSync(output, "#endif\n\n", undefined)
 for (const fileName of fileQueue) {
   fs.writeSync(output, `// begin ${fileName}\n`)
   const content = fs.readFileSync(fileName, 'utf-8')
-  fs.writeSync(output, content
-    .replace(/^#.*$/gm, '')
+  fs.writeSync(output, stripIncludes(stripConditionalIncludes(content))
     .replace(/^namespace dui \{$/gm, '')
     .replace(/^\} \/\/ namespace dui$/gm, '')
     .trim()
@@ -75,3 +76,72 @@ function getDependencies(content) {
   }
   return result
 }
+
+/**
+ * Collect the system includes (the ones using <>) from all files
+ * @param {string[]} files
+ */
+function getSystemIncludes(files) {
+  const result = new Set(['#include <SDL.h>'])
+  for (const file of files) {
+    const content = fs.readFileSync(file, 'utf-8')
+    const unconditional = stripConditionalIncludes(content)
+    for (const m of unconditional.matchAll(/^#include <.*>$/gm)) {
+      result.add(m[0])
+    }
+  }
+  return [...result].sort()
+}
+
+/**
+ * Collect the conditional blocks (like platform checks) that include system
+ * headers. They are hoisted as a whole, so they must not be nested inside the
+ * namespace and must not contain other conditionals.
+ * @param {string[]} files
+ */
+function getConditionalIncludes(files) {
+  const result = new Set()
+  for (const file of files) {
+    const content = stripGuard(fs.readFileSync(file, 'utf-8'))
+    for (const m of content.matchAll(/^#if[\s\S]*?^#endif.*$/gm)) {
+      if (/^#include </m.test(m[0])) {
+        result.add(m[0])
+      }
+    }
+  }
+  return [...result]
+}
+
+/**
+ * Remove conditional blocks containing system includes
+ * @param {string} content
+ */
+function stripConditionalIncludes(content) {
+  return stripGuard(content).replace(/^#if[\s\S]*?^#endif.*$/gm,
+    block => /^#include </m.test(block) ? '' : block)
+}
+
+/**
+ * Remove include guards
+ * @param {string} content
+ */
+function stripGuard(content) {
+  const guard = content.match(/^#ifndef (\w+)\n#define \1$/m)
+  if (guard) {
+    const end = content.lastIndexOf('#endif')
+    content = content.slice(0, end) + content.slice(end).replace(/^#endif.*$/m, '')
+    content = content.replace(guard[0], '')
+  }
+  return content
+}
+
+/**
+ * Remove includes and include guards, keeping any other preprocessor
+ * directive (like feature checks)
+ * @param {string} content
+ */
+function stripIncludes(content) {
+  return stripGuard(content)
+    .replace(/^#include.*$/gm, '')
+    .replace(/^#pragma once$/gm, '')
+}
@@ -0,0 +1,115 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "dui.hpp"
+
+// Builds many independent States on a ThreadPool, sending every event to all
+// of them like parallel_demo does, and checks each one only got the text typed
+// on its own field. Run it with -DDUI_SANITIZE_THREAD=ON to check for races.
+
+constexpr int FRAMES = 800;
+constexpr char KEYS[] = "0123456789!#$%&*";
+constexpr unsigned SURFACES = sizeof(KEYS) - 1;
+
+struct Surface
+{
+  std::unique_ptr<dui::State> state;
+  SDL_Rect rect;
+  std::string text{"Ahoy"};
+  int value = 0;
+  int typed = 0; ///< How many keys were sent while its field was clicked
+};
+
+void
+buildSurface(Surface& surface, unsigned index)
+{
+  auto f = dui::frame(*surface.state);
+  if (auto p = dui::panel(f, {"surface", index}, surface.rect)) {
+    dui::textField(p, "text", &surface.text);
+    dui::numberField(p, "value", &surface.value);
+    dui::sliderBox(p, "slider", &surface.value, 0, 100);
+  }
+  f.end();
+}
+
+int
+main(int argc, char** argv)
+{
+  if (SDL_Init(0) < 0) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+  SDL_Surface* screen =
+    SDL_CreateRGBSurfaceWithFormat(0, 800, 800, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer =
+    screen ? SDL_CreateSoftwareRenderer(screen) : nullptr;
+  if (!renderer) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  std::vector<Surface> surfaces(SURFACES);
+  for (unsigned i = 0; i < surfaces.size(); ++i) {
+    surfaces[i].state = std::make_unique<dui::State>(renderer);
+    surfaces[i].rect = {int(i % 4) * 200, int(i / 4) * 200, 190, 190};
+  }
+  dui::ThreadPool pool{4};
+
+  for (int frame = 0; frame < FRAMES; ++frame) {
+    // Click on the text field of each surface in turn and type its key
+    unsigned target = (frame / 4) % surfaces.size();
+    auto& rect = surfaces[target].rect;
+    SDL_Event ev;
+    SDL_zero(ev);
+    ev.type = frame % 4 < 2 ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+    ev.button.button = SDL_BUTTON_LEFT;
+    ev.button.x = rect.x + 20;
+    ev.button.y = rect.y + 10;
+    if (frame % 4 == 3) {
+      ev.type = SDL_TEXTINPUT;
+      ev.text.text[0] = KEYS[target];
+      surfaces[target].typed += 1;
+    }
+    for (auto& surface : surfaces) {
+      surface.state->event(ev);
+    }
+
+    pool.run(surfaces.size(), [&](size_t index, size_t) {
+      buildSurface(surfaces[index], unsigned(index));
+    });
+    for (auto& surface : surfaces) {
+      surface.state->render();
+    }
+  }
+
+  int failures = 0;
+  for (unsigned i = 0; i < surfaces.size(); ++i) {
+    auto& surface = surfaces[i];
+    // Where the keys went depends on the cursor, but nothing else may change
+    std::string original;
+    int own = 0;
+    for (char ch : surface.text) {
+      if (ch == KEYS[i]) {
+        own += 1;
+      } else {
+        original += ch;
+      }
+    }
+    if (original != "Ahoy" || own != surface.typed) {
+      fprintf(stderr,
+              "Surface %u: got \"%s\", expected \"Ahoy\" and %d '%c'\n",
+              i,
+              surface.text.c_str(),
+              surface.typed,
+              KEYS[i]);
+      failures += 1;
+    }
+  }
+
+  surfaces.clear();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(screen);
+  SDL_Quit();
+  return failures == 0 ? 0 : 1;
+}
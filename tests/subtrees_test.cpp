@@ -0,0 +1,124 @@
+#include <string>
+#include <SDL.h>
+#include "dui.hpp"
+
+// Feeds the same clicks and keys to a State building two panels in sequence
+// and to another building them as Subtrees on a ThreadPool, and checks the
+// focus moves the same way, so each key lands on the same text field.
+
+struct Fields
+{
+  std::string text[2]{"Ahoy", "Ahoy"};
+  int value[2]{0, 0};
+};
+
+constexpr SDL_Rect PANELS[2]{{0, 0, 300, 200}, {300, 0, 300, 200}};
+
+void
+buildPanel(dui::Target target, Fields& fields, unsigned index)
+{
+  if (auto p = dui::panel(target, {"panel", index}, PANELS[index])) {
+    dui::textField(p, "text", &fields.text[index]);
+    dui::sliderBox(p, "slider", &fields.value[index], 0, 100);
+  }
+}
+
+struct Step
+{
+  int x, y;
+  char key;
+};
+
+int
+main(int argc, char** argv)
+{
+  if (SDL_Init(0) < 0) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+  SDL_Surface* screen =
+    SDL_CreateRGBSurfaceWithFormat(0, 800, 600, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer =
+    screen ? SDL_CreateSoftwareRenderer(screen) : nullptr;
+  if (!renderer) {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    return 1;
+  }
+
+  int failures = 0;
+  {
+    dui::State serial{renderer};
+    dui::State parallel{renderer};
+    Fields serialFields;
+    Fields parallelFields;
+    dui::ThreadPool pool{2};
+
+    // Clicking from the field of one panel to the other's, both ways, and
+    // outside both
+    Step steps[]{
+      {20, 10, 'a'},
+      {320, 10, 'b'},
+      {20, 10, 'c'},
+      {700, 300, 'd'},
+      {320, 10, 'e'},
+      {320, 10, 'f'},
+    };
+    for (auto& step : steps) {
+      for (int frame = 0; frame < 3; ++frame) {
+        SDL_Event ev;
+        SDL_zero(ev);
+        ev.type = frame == 0 ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+        ev.button.button = SDL_BUTTON_LEFT;
+        ev.button.x = step.x;
+        ev.button.y = step.y;
+        if (frame == 2) {
+          ev.type = SDL_TEXTINPUT;
+          ev.text.text[0] = step.key;
+        }
+        serial.event(ev);
+        parallel.event(ev);
+
+        auto f = dui::frame(serial);
+        buildPanel(f, serialFields, 0);
+        buildPanel(f, serialFields, 1);
+        f.end();
+
+        auto g = dui::frame(parallel);
+        {
+          dui::Subtrees subtrees{g};
+          for (unsigned i = 0; i < 2; ++i) {
+            subtrees.add({"subtree", i}, [&, i](dui::Target target) {
+              buildPanel(target, parallelFields, i);
+            });
+          }
+          subtrees.build(pool);
+        }
+        g.end();
+      }
+      for (unsigned i = 0; i < 2; ++i) {
+        if (serialFields.text[i] != parallelFields.text[i]) {
+          fprintf(stderr,
+                  "After '%c', panel %u: serial \"%s\", parallel \"%s\"\n",
+                  step.key,
+                  i,
+                  serialFields.text[i].c_str(),
+                  parallelFields.text[i].c_str());
+          failures += 1;
+        }
+      }
+    }
+    // Checks the script itself did what it was meant to
+    if (serialFields.text[0].size() != 6 || serialFields.text[1].size() != 7) {
+      fprintf(stderr,
+              "Unexpected serial texts \"%s\" and \"%s\"\n",
+              serialFields.text[0].c_str(),
+              serialFields.text[1].c_str());
+      failures += 1;
+    }
+  }
+
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(screen);
+  SDL_Quit();
+  return failures == 0 ? 0 : 1;
+}